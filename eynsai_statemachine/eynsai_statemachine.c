@@ -15,6 +15,7 @@
 #include "mouse_buffer.h"
 #include "mouse_passthrough.h"
 #include "rgb_indicators.h"
+#include "eynsai_statemachine_indicators.h"
 #include "mouse_axis_snapping.h"
 
 #ifdef CONSOLE_ENABLE
@@ -23,65 +24,6 @@
 
 ASSERT_COMMUNITY_MODULES_MIN_API_VERSION(1, 1, 0);
 
-// ============================================================================
-// RGB INDICATOR DEFINITIONS
-// ============================================================================
-
-typedef enum indicator_state_t {
-    INDICATOR_STATE_OFF = 0,
-    INDICATOR_STATE_BASE,
-    INDICATOR_STATE_ONESHOT,
-} indicator_state_t;
-
-typedef enum indicator_transition_t {
-    INDICATOR_TRANSITION_TO_CTRL = 0,
-    INDICATOR_TRANSITION_TO_SHIFT,
-    INDICATOR_TRANSITION_TO_ALT,
-    INDICATOR_TRANSITION_TO_GUI,
-    INDICATOR_TRANSITION_TO_QWER,
-    INDICATOR_TRANSITION_TO_GAME,
-    INDICATOR_TRANSITION_FROM_CTRL,
-    INDICATOR_TRANSITION_FROM_SHIFT,
-    INDICATOR_TRANSITION_FROM_ALT,
-    INDICATOR_TRANSITION_FROM_GUI,
-    INDICATOR_TRANSITION_FROM_QWER,
-    INDICATOR_TRANSITION_FROM_GAME,
-    INDICATOR_TRANSITION_FROM_MULTIPLE,
-    INDICATOR_TRANSITION_FLASH_NEUTRAL,
-    INDICATOR_TRANSITION_FLASH_CTRL,
-    INDICATOR_TRANSITION_FLASH_SHIFT,
-    INDICATOR_TRANSITION_FLASH_ALT,
-    INDICATOR_TRANSITION_FLASH_GUI,
-    INDICATOR_TRANSITION_FLASH_BITWIG,
-} indicator_transition_t;
-
-const rgb_indicator_state_t rgb_indicator_states[] = {
-    [INDICATOR_STATE_OFF] = { .breathing = false, .color_a = {0, 0, 0} },
-    [INDICATOR_STATE_BASE] = { .breathing = false, .color_a = COLOR_NEUTRAL },
-    [INDICATOR_STATE_ONESHOT] = { .breathing = true, .color_a = COLOR_ONESHOT_A, .color_b = COLOR_ONESHOT_B, .period_ms = 4000 },
-};
-const rgb_indicator_transition_t rgb_indicator_transitions[] = {
-    [INDICATOR_TRANSITION_TO_CTRL] = { .accent_color = COLOR_CTRL, TIMING_TO },
-    [INDICATOR_TRANSITION_TO_SHIFT] = { .accent_color = COLOR_SHIFT, TIMING_TO },
-    [INDICATOR_TRANSITION_TO_ALT] = { .accent_color = COLOR_ALT, TIMING_TO },
-    [INDICATOR_TRANSITION_TO_GUI] = { .accent_color = COLOR_GUI, TIMING_TO },
-    [INDICATOR_TRANSITION_TO_QWER] = { .accent_color = COLOR_QWER, TIMING_TO },
-    [INDICATOR_TRANSITION_TO_GAME] = { .accent_color = COLOR_GAME, TIMING_TO },
-    [INDICATOR_TRANSITION_FROM_CTRL] = { .accent_color = COLOR_CTRL, TIMING_FROM },
-    [INDICATOR_TRANSITION_FROM_SHIFT] = { .accent_color = COLOR_SHIFT, TIMING_FROM },
-    [INDICATOR_TRANSITION_FROM_ALT] = { .accent_color = COLOR_ALT, TIMING_FROM },
-    [INDICATOR_TRANSITION_FROM_GUI] = { .accent_color = COLOR_GUI, TIMING_FROM },
-    [INDICATOR_TRANSITION_FROM_QWER] = { .accent_color = COLOR_QWER, TIMING_FROM },
-    [INDICATOR_TRANSITION_FROM_GAME] = { .accent_color = COLOR_GAME, TIMING_FROM },
-    [INDICATOR_TRANSITION_FROM_MULTIPLE] = { .accent_color = COLOR_ONESHOT_MIDPOINT, TIMING_FROM },
-    [INDICATOR_TRANSITION_FLASH_NEUTRAL] = { .accent_color = COLOR_NEUTRAL, TIMING_FLASH },
-    [INDICATOR_TRANSITION_FLASH_CTRL] = { .accent_color = COLOR_CTRL, TIMING_FLASH },
-    [INDICATOR_TRANSITION_FLASH_SHIFT] = { .accent_color = COLOR_SHIFT, TIMING_FLASH },
-    [INDICATOR_TRANSITION_FLASH_ALT] = { .accent_color = COLOR_ALT, TIMING_FLASH },
-    [INDICATOR_TRANSITION_FLASH_GUI] = { .accent_color = COLOR_GUI, TIMING_FLASH },
-    [INDICATOR_TRANSITION_FLASH_BITWIG] = { .accent_color = COLOR_BITWIG, TIMING_FLASH },
-};
-
 // ============================================================================
 // EVENT WATCHERS 
 // ============================================================================
@@ -146,6 +88,7 @@ typedef enum fsm_node_t {
     // base layer switching
     FSM_BASE_AMBIGUOUS,
 
+    FSM_NODE_COUNT,
 } fsm_node_t;
 
 static fsm_node_t state = FSM_NEUTRAL;
@@ -170,11 +113,27 @@ static hires_dragscroll_config_t bitwig_scroll_config = {
     .invert_horizontal = true,
 };
 
+// mods and indicator transitions of the superkeys that can make up a composite oneshot, indexed from KC_SUPERCTRL
+static const struct {
+    uint8_t mod_bit;
+    uint8_t flash_transition;
+    uint8_t from_transition;
+} composite_oneshot_mods[] = {
+    {MOD_BIT(KC_LEFT_CTRL), INDICATOR_TRANSITION_FLASH_CTRL, INDICATOR_TRANSITION_FROM_CTRL},
+    {MOD_BIT(KC_LEFT_SHIFT), INDICATOR_TRANSITION_FLASH_SHIFT, INDICATOR_TRANSITION_FROM_SHIFT},
+    {MOD_BIT(KC_LEFT_ALT), INDICATOR_TRANSITION_FLASH_ALT, INDICATOR_TRANSITION_FROM_ALT},
+    {MOD_BIT(KC_LEFT_GUI), INDICATOR_TRANSITION_FLASH_GUI, INDICATOR_TRANSITION_FROM_GUI},
+};
+
+static uint8_t base_indicator_state(void) {
+    return base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE;
+}
+
 static void transition_to_neutral(void) {
     clear_keyboard();
     hires_dragscroll_off();
     mouse_axis_snapping_off();
-    mouse_passthrough_set_pointer_state(false, false);
+    mouse_passthrough_set_pointer_state(MOUSE_PASSTHROUGH_ALL_DEVICES, false, false);
     mouse_watcher_off();
     simple_timer_off();
     layer_off(LAYER_UTIL);
@@ -186,88 +145,229 @@ static void transition_to_neutral(void) {
 
 static void bitwig_mode_on(void) {
     bitwig_mode_is_on = true;
-    rgb_indicators_start_transition(INDICATOR_TRANSITION_FLASH_BITWIG, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
+    rgb_indicators_start_transition(INDICATOR_TRANSITION_FLASH_BITWIG, base_indicator_state());
 }
 
 static void bitwig_mode_off(void) {
     bitwig_mode_is_on = false;
     mouse_axis_snapping_off();
-    mouse_passthrough_set_pointer_state(false, false);
-    rgb_indicators_start_transition(INDICATOR_TRANSITION_FLASH_NEUTRAL, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
+    mouse_passthrough_set_pointer_state(MOUSE_PASSTHROUGH_ALL_DEVICES, false, false);
+    rgb_indicators_start_transition(INDICATOR_TRANSITION_FLASH_NEUTRAL, base_indicator_state());
 }
 
 static void bitwig_mode_toggle(void) {
     if (bitwig_mode_is_on) {bitwig_mode_off(); } else { bitwig_mode_on(); }
 }
 
+static void tap_wheel_as_arrow(uint16_t keycode) {
+    tap_code(keycode == KC_INV_MOUSEKEY_WHEEL_UP ? KC_UP : keycode == KC_INV_MOUSEKEY_WHEEL_DOWN ? KC_DOWN : keycode == KC_INV_MOUSEKEY_WHEEL_LEFT ? KC_LEFT : KC_RIGHT);
+}
+
 // ============================================================================
-// MODULE API
+// EVENTS
 // ============================================================================
 
-void keyboard_post_init_eynsai_statemachine(void) {
-    mouse_passthrough_set_buttons_state(true, true);
-    mouse_passthrough_set_wheel_state(true, true);
+// every key event is classified exactly once, the statemachine's own keycodes each get their own pair of events and everything else
+// is grouped by how the statemachine treats it (the release of a class always directly precedes its press)
+typedef enum fsm_event_t {
+    FSM_EVENT_SUPERCTRL_RELEASE = 0,
+    FSM_EVENT_SUPERCTRL_PRESS,
+    FSM_EVENT_SUPERSHIFT_RELEASE,
+    FSM_EVENT_SUPERSHIFT_PRESS,
+    FSM_EVENT_SUPERALT_RELEASE,
+    FSM_EVENT_SUPERALT_PRESS,
+    FSM_EVENT_SUPERGUI_RELEASE,
+    FSM_EVENT_SUPERGUI_PRESS,
+    FSM_EVENT_BITWIG_RELEASE,
+    FSM_EVENT_BITWIG_PRESS,
+    FSM_EVENT_BASE_RELEASE,
+    FSM_EVENT_BASE_PRESS,
+
+    // the event watchers always send releases, but the presses are kept so that every class is a pair
+    FSM_EVENT_TIMEOUT_RELEASE,
+    FSM_EVENT_TIMEOUT_PRESS,
+    FSM_EVENT_MOUSE_WATCHER_RELEASE,
+    FSM_EVENT_MOUSE_WATCHER_PRESS,
+
+    // inverse mousekeys
+    FSM_EVENT_BUTTON_RELEASE,
+    FSM_EVENT_BUTTON_PRESS,
+    FSM_EVENT_WHEEL_RELEASE,
+    FSM_EVENT_WHEEL_PRESS,
+
+    // basic keycodes (also with mods) that the supermods apply to
+    FSM_EVENT_KEY_RELEASE,
+    FSM_EVENT_KEY_PRESS,
+
+    // anything else (layer keys, other modules' keycodes, ...)
+    FSM_EVENT_OTHER_RELEASE,
+    FSM_EVENT_OTHER_PRESS,
+
+    FSM_EVENT_COUNT,
+} fsm_event_t;
+
+static fsm_event_t classify_event(uint16_t keycode, bool pressed) {
+    fsm_event_t release_event;
+    if (IS_STATEMACHINE_KEY(keycode)) {
+        release_event = FSM_EVENT_SUPERCTRL_RELEASE + 2 * (keycode - KC_SUPERCTRL);
+    } else if (IS_INVERSE_MOUSEKEY_BUTTON(keycode)) {
+        release_event = FSM_EVENT_BUTTON_RELEASE;
+    } else if (IS_INVERSE_MOUSEKEY_WHEEL(keycode)) {
+        release_event = FSM_EVENT_WHEEL_RELEASE;
+    } else if (IS_MODIFIABLE_KEY(keycode)) {
+        release_event = FSM_EVENT_KEY_RELEASE;
+    } else {
+        release_event = FSM_EVENT_OTHER_RELEASE;
+    }
+    return release_event + (pressed ? 1 : 0);
 }
 
-bool process_record_eynsai_statemachine(uint16_t keycode, keyrecord_t *record) {
+// ============================================================================
+// ACTIONS
+// ============================================================================
 
-    // special case for momentary keycodes
-    if (IS_QK_MOMENTARY(keycode)) return true;
+typedef enum fsm_action_t {
+
+    // generic
+    FSM_ACTION_BLOCK = 0,
+    FSM_ACTION_PASS,
+    FSM_ACTION_NEUTRAL,
+    FSM_ACTION_NEUTRAL_AND_RETRY,
+
+    // neutral
+    FSM_ACTION_SUPERCTRL,
+    FSM_ACTION_SUPERSHIFT,
+    FSM_ACTION_SUPERALT,
+    FSM_ACTION_SUPERGUI,
+    FSM_ACTION_BASE,
+
+    // superctrl
+    FSM_ACTION_CTRL_TAPPED_TIMEOUT,
+    FSM_ACTION_CTRL_TAPPED_KEY,
+    FSM_ACTION_CTRL_TAPPED_BUTTON,
+    FSM_ACTION_CTRL_TAPPED_WHEEL,
+    FSM_ACTION_CTRL_TAPPED_RELEASE,
+    FSM_ACTION_CTRL_HELD_KEY,
+    FSM_ACTION_CTRL_HELD_BUTTON,
+    FSM_ACTION_CTRL_HELD_WHEEL,
+    FSM_ACTION_UTIL_ONESHOT_KEY,
+    FSM_ACTION_UTIL_ONESHOT_EXIT,
+    FSM_ACTION_UTIL_ONESHOT_BITWIG,
+    FSM_ACTION_UTIL_ONESHOT_COMPOSITE,
+    FSM_ACTION_UTIL_ONESHOT_DRAGSCROLL,
+    FSM_ACTION_DRAGSCROLL_CTRL,
+
+    // supershift
+    FSM_ACTION_SHIFT_HELD_KEY,
+    FSM_ACTION_SHIFT_HELD_BUTTON,
+    FSM_ACTION_SHIFT_HELD_WHEEL,
+    FSM_ACTION_AXIS_SNAPPING_BUTTON_RELEASE,
+    FSM_ACTION_ADD_CTRL_AND_SHIFT,
+    FSM_ACTION_ADD_CTRL,
+    FSM_ACTION_ADD_SHIFT,
+    FSM_ACTION_REMOVE_CTRL,
+    FSM_ACTION_REMOVE_SHIFT,
+
+    // superalt
+    FSM_ACTION_ALT_TAPPED_TIMEOUT,
+    FSM_ACTION_ALT_TAPPED_KEY,
+    FSM_ACTION_ALT_TAPPED_BUTTON,
+    FSM_ACTION_ALT_TAPPED_WHEEL,
+    FSM_ACTION_ALT_TAPPED_RELEASE,
+    FSM_ACTION_ALT_HELD_KEY,
+    FSM_ACTION_ALT_HELD_BUTTON,
+    FSM_ACTION_ALT_HELD_WHEEL,
+    FSM_ACTION_MOVE_WHEEL,
+
+    // supergui
+    FSM_ACTION_GUI_AMBIGUOUS_TIMEOUT,
+    FSM_ACTION_GUI_AMBIGUOUS_KEY,
+    FSM_ACTION_GUI_AMBIGUOUS_RELEASE,
+    FSM_ACTION_GUI_HELD_KEY,
+
+    // composite oneshot
+    FSM_ACTION_COMPOSITE_ONESHOT_KEY,
+    FSM_ACTION_COMPOSITE_ONESHOT_MOD,
+    FSM_ACTION_COMPOSITE_ONESHOT_EXIT,
+
+    // base layer switching
+    FSM_ACTION_BASE_TIMEOUT,
+    FSM_ACTION_BASE_RELEASE,
+
+} fsm_action_t;
+
+// returns whether the key event should be processed any further, just like process_record
+static bool run_action(fsm_action_t action, uint16_t keycode, keyrecord_t *record, bool pointer_buttons_held) {
+    switch (action) {
+
+        case FSM_ACTION_BLOCK:
+            return false;
+
+        case FSM_ACTION_PASS:
+            return true;
+
+        case FSM_ACTION_NEUTRAL:
+            transition_to_neutral();
+            return false;
 
-    // main statemachine
-    switch (state) {
+        case FSM_ACTION_NEUTRAL_AND_RETRY:
+            transition_to_neutral();
+            return process_record_eynsai_statemachine(keycode, record);
 
-        case FSM_NEUTRAL:
-            if (record->event.pressed && keycode == KC_SUPERCTRL && pointing_device_get_report().buttons == 0) {
+        // --------------------------------------------------------------------
+        // NEUTRAL
+        // --------------------------------------------------------------------
+
+        case FSM_ACTION_SUPERCTRL:
+            if (!pointer_buttons_held) {
                 state = FSM_CTRL_TAPPED;
                 simple_timer_on(SUPERCTRL_TAPPING_TERM);
-                return false;
-            }
-            if (record->event.pressed && keycode == KC_SUPERCTRL && pointing_device_get_report().buttons > 0) {
+            } else {
                 state = FSM_CTRL_REGISTERED;
                 register_code(KC_LEFT_CTRL);
-                return false;
             }
-            if (record->event.pressed && keycode == KC_SUPERSHIFT && pointing_device_get_report().buttons == 0) {
+            return false;
+
+        case FSM_ACTION_SUPERSHIFT:
+            if (!pointer_buttons_held) {
                 state = FSM_SHIFT_HELD;
-                return false;
-            }
-            if (record->event.pressed && keycode == KC_SUPERSHIFT && pointing_device_get_report().buttons > 0 && !bitwig_mode_is_on) {
+            } else if (!bitwig_mode_is_on) {
                 state = FSM_SHIFT_REGISTERED;
                 register_code(KC_LEFT_SHIFT);
-                return false;
-            }
-            if (record->event.pressed && keycode == KC_SUPERSHIFT && pointing_device_get_report().buttons > 0 && bitwig_mode_is_on) {
+            } else {
                 state = FSM_MOUSE_AXIS_SNAPPING;
                 mouse_axis_snapping_on();
-                mouse_passthrough_set_pointer_state(true, true);
-                return false;
+                mouse_passthrough_set_pointer_filter(MOUSE_PASSTHROUGH_ALL_DEVICES, MOUSE_PASSTHROUGH_POINTER_FILTER_AXIS_SNAPPING);
+                mouse_passthrough_set_pointer_state(MOUSE_PASSTHROUGH_ALL_DEVICES, true, true);
             }
-            if (record->event.pressed && keycode == KC_SUPERALT && pointing_device_get_report().buttons == 0) {
+            return false;
+
+        case FSM_ACTION_SUPERALT:
+            if (!pointer_buttons_held) {
                 state = FSM_ALT_TAPPED;
                 simple_timer_on(SUPERALT_TAPPING_TERM);
                 clear_keyboard_but_mods();
                 layer_on(LAYER_MOVE);
-                return false;
-            }
-            if (record->event.pressed && keycode == KC_SUPERALT && pointing_device_get_report().buttons > 0) {
+            } else {
                 state = FSM_ALT_REGISTERED;
                 register_code(KC_LEFT_ALT);
-                return false;
-            }
-            if (record->event.pressed && keycode == KC_SUPERGUI) {
-                state = FSM_GUI_AMBIGUOUS;
-                simple_timer_on(SUPERGUI_TAPPING_TERM);
-                clear_keyboard_but_mods();
-                layer_on(LAYER_FUNC);
-                return false;
             }
-            if (record->event.pressed && keycode == KC_BASE && base_layer == LAYER_WORK) {
+            return false;
+
+        case FSM_ACTION_SUPERGUI:
+            state = FSM_GUI_AMBIGUOUS;
+            simple_timer_on(SUPERGUI_TAPPING_TERM);
+            clear_keyboard_but_mods();
+            layer_on(LAYER_FUNC);
+            return false;
+
+        case FSM_ACTION_BASE:
+            if (base_layer == LAYER_WORK) {
                 state = FSM_BASE_AMBIGUOUS;
                 simple_timer_on(BASE_TAPPING_TERM);
                 return false;
             }
-            if (record->event.pressed && keycode == KC_BASE && base_layer == LAYER_QWER) {
+            if (base_layer == LAYER_QWER) {
                 state = FSM_NEUTRAL;
                 base_layer = LAYER_WORK;
                 rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_QWER, INDICATOR_STATE_OFF);
@@ -275,7 +375,7 @@ bool process_record_eynsai_statemachine(uint16_t keycode, keyrecord_t *record) {
                 transition_to_neutral();
                 return false;
             }
-            if (record->event.pressed && keycode == KC_BASE && base_layer == LAYER_GAME) {
+            if (base_layer == LAYER_GAME) {
                 state = FSM_NEUTRAL;
                 base_layer = LAYER_WORK;
                 rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_GAME, INDICATOR_STATE_OFF);
@@ -284,539 +384,577 @@ bool process_record_eynsai_statemachine(uint16_t keycode, keyrecord_t *record) {
                 return false;
             }
             return true;
-            
+
         // --------------------------------------------------------------------
         // SUPERCTRL
         // --------------------------------------------------------------------
 
-        case FSM_CTRL_TAPPED:
-            if (record->event.pressed && (keycode == KC_SUPERALT || keycode == KC_SUPERGUI)) {
-                transition_to_neutral();
-                return process_record_eynsai_statemachine(keycode, record);
-            }
-            if (keycode == KC_TIMEOUT_EVENT) {
-                state = FSM_CTRL_HELD;
-                return false;
-            }
-            if (record->event.pressed && IS_MODIFIABLE_KEY(keycode)) {
-                state = FSM_CTRL_REGISTERED;
-                simple_timer_off();
-                register_code(KC_LEFT_CTRL);
-                return true;
-            }
-            if ((record->event.pressed && IS_INVERSE_MOUSEKEY_BUTTON(keycode)) || (IS_INVERSE_MOUSEKEY_WHEEL(keycode) && !bitwig_mode_is_on)) {
-                state = FSM_CTRL_REGISTERED;
-                simple_timer_off();
-                register_code(KC_LEFT_CTRL);
-                mouse_buffer_on(MOUSE_BUFFER_DURATION);
-                return true;
-            }
-            if (IS_INVERSE_MOUSEKEY_WHEEL(keycode) && bitwig_mode_is_on) {
-                state = FSM_CTRL_REGISTERED;
-                register_code(KC_LEFT_CTRL);
-                register_code(KC_LEFT_ALT);
-                simple_timer_off();
-                mouse_buffer_on(MOUSE_BUFFER_DURATION);
-                return true;
-            }
-            if (!record->event.pressed && keycode == KC_SUPERCTRL) {
-                state = FSM_UTIL_ONESHOT_WAITING;
-                simple_timer_off();
-                clear_keyboard();
-                layer_on(LAYER_UTIL);
-                mouse_passthrough_set_pointer_state(true, true);
-                mouse_watcher_on(DRAGSCROLL_DETECTION_DEADZONE);
-                if (bitwig_mode_is_on) { hires_dragscroll_on_with_config(bitwig_scroll_config); } else { hires_dragscroll_on(); }
-                rgb_indicators_start_transition(INDICATOR_TRANSITION_TO_CTRL, INDICATOR_STATE_ONESHOT);
-                return false;
-            }
+        case FSM_ACTION_CTRL_TAPPED_TIMEOUT:
+            state = FSM_CTRL_HELD;
             return false;
 
-        case FSM_CTRL_HELD:
-            if (!record->event.pressed && keycode == KC_SUPERCTRL) {
-                transition_to_neutral();
-                return false;
-            }
-            if (record->event.pressed && (keycode == KC_SUPERALT || keycode == KC_SUPERGUI)) {
-                transition_to_neutral();
-                return process_record_eynsai_statemachine(keycode, record);
-            }
-            if (record->event.pressed && IS_MODIFIABLE_KEY(keycode)) {
-                state = FSM_CTRL_REGISTERED;
-                register_code(KC_LEFT_CTRL);
-                return true;
-            }
-            if ((record->event.pressed && IS_INVERSE_MOUSEKEY_BUTTON(keycode)) || (IS_INVERSE_MOUSEKEY_WHEEL(keycode) && !bitwig_mode_is_on)) {
-                state = FSM_CTRL_REGISTERED;
-                register_code(KC_LEFT_CTRL);
-                mouse_buffer_on(MOUSE_BUFFER_DURATION);
-                return true;
-            }
-            if (IS_INVERSE_MOUSEKEY_WHEEL(keycode) && bitwig_mode_is_on) {
-                state = FSM_CTRL_REGISTERED;
-                register_code(KC_LEFT_CTRL);
-                register_code(KC_LEFT_ALT);
-                mouse_buffer_on(MOUSE_BUFFER_DURATION);
-                return true;
-            }
-            if (record->event.pressed && keycode == KC_SUPERSHIFT) {
-                state = FSM_CTRL_SHIFT_REGISTERED;
-                register_code(KC_LEFT_CTRL);
-                register_code(KC_LEFT_SHIFT);
-                return false;
-            }
-            return false;
+        case FSM_ACTION_CTRL_TAPPED_KEY:
+            simple_timer_off();
+            // fall through
+        case FSM_ACTION_CTRL_HELD_KEY:
+            state = FSM_CTRL_REGISTERED;
+            register_code(KC_LEFT_CTRL);
+            return true;
 
-        case FSM_CTRL_REGISTERED:
-            if (IS_MODIFIABLE_KEY(keycode) || IS_INVERSE_MOUSEKEY(keycode)) {
-                return true;
-            }
-            if (!record->event.pressed && keycode == KC_SUPERCTRL) {
-                transition_to_neutral();
-                return false;
-            }
-            if (record->event.pressed && (keycode == KC_SUPERALT || keycode == KC_SUPERGUI)) {
-                transition_to_neutral();
-                return process_record_eynsai_statemachine(keycode, record);
-            }
-            if (record->event.pressed && keycode == KC_SUPERSHIFT) {
-                state = FSM_CTRL_SHIFT_REGISTERED;
-                register_code(KC_LEFT_SHIFT);
-                return false;
-            }
+        case FSM_ACTION_CTRL_TAPPED_BUTTON:
+            simple_timer_off();
+            // fall through
+        case FSM_ACTION_CTRL_HELD_BUTTON:
+            state = FSM_CTRL_REGISTERED;
+            register_code(KC_LEFT_CTRL);
+            mouse_buffer_on(MOUSE_BUFFER_DURATION);
+            return true;
+
+        case FSM_ACTION_CTRL_TAPPED_WHEEL:
+            simple_timer_off();
+            // fall through
+        case FSM_ACTION_CTRL_HELD_WHEEL:
+            state = FSM_CTRL_REGISTERED;
+            register_code(KC_LEFT_CTRL);
+            if (bitwig_mode_is_on) register_code(KC_LEFT_ALT);
+            mouse_buffer_on(MOUSE_BUFFER_DURATION);
+            return true;
+
+        case FSM_ACTION_CTRL_TAPPED_RELEASE:
+            state = FSM_UTIL_ONESHOT_WAITING;
+            simple_timer_off();
+            clear_keyboard();
+            layer_on(LAYER_UTIL);
+            mouse_passthrough_set_pointer_filter(MOUSE_PASSTHROUGH_ALL_DEVICES, MOUSE_PASSTHROUGH_POINTER_FILTER_DRAGSCROLL);
+            mouse_passthrough_set_pointer_state(MOUSE_PASSTHROUGH_ALL_DEVICES, true, true);
+            mouse_watcher_on(DRAGSCROLL_DETECTION_DEADZONE);
+            if (bitwig_mode_is_on) { hires_dragscroll_on_with_config(bitwig_scroll_config); } else { hires_dragscroll_on(); }
+            rgb_indicators_start_transition(INDICATOR_TRANSITION_TO_CTRL, INDICATOR_STATE_ONESHOT);
             return false;
 
-        case FSM_UTIL_ONESHOT_WAITING:
+        case FSM_ACTION_UTIL_ONESHOT_KEY:
+            state = FSM_UTIL_ONESHOT_ACTIVE;
+            mouse_watcher_off();
+            return true;
 
-            // NOTE: opportunity to do something with these; they're pretty ergonomic
-            // if (record->event.pressed && IS_INVERSE_MOUSEKEY_BUTTON(keycode)) {
-            //     return false;
-            // }
-            // if (IS_INVERSE_MOUSEKEY_WHEEL(keycode)) {
-            //     return false;
-            // }
+        case FSM_ACTION_UTIL_ONESHOT_EXIT:
+            rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_CTRL, base_indicator_state());
+            transition_to_neutral();
+            return false;
 
-            if (record->event.pressed && keycode == KC_SUPERCTRL) {
-                rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_CTRL, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
-                transition_to_neutral();
-                return false;
-            }
-            if (record->event.pressed && keycode == KC_BITWIG) {
-                bitwig_mode_toggle();
-                // rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_CTRL, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
-                transition_to_neutral();
-                return false;
-            }
-            if (record->event.pressed && !IS_INVERSE_MOUSEKEY(keycode) && !IS_STATEMACHINE_KEY(keycode)) {
-                state = FSM_UTIL_ONESHOT_ACTIVE;
-                mouse_watcher_off();
-                return true;
-            }
-            if (keycode == KC_MOUSE_WATCHER_EVENT) {
-                state = FSM_DRAGSCROLL;
-                mouse_watcher_off();
-                layer_off(LAYER_UTIL);
-                return false;
-            }
-            if (record->event.pressed && (keycode == KC_SUPERSHIFT || keycode == KC_SUPERALT || keycode == KC_SUPERGUI)) {
-                state = FSM_COMPOSITE_ONESHOT_WAITING;
-                hires_dragscroll_off();
-                mouse_passthrough_set_pointer_state(false, false);
-                mouse_watcher_off();
-                layer_off(LAYER_UTIL);
-                if (keycode == KC_SUPERSHIFT) {
-                    composite_oneshot_mod_bits = MOD_BIT(KC_LEFT_CTRL) | MOD_BIT(KC_LEFT_SHIFT);
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FLASH_SHIFT, INDICATOR_STATE_ONESHOT);
-                } else if (keycode == KC_SUPERALT) {
-                    composite_oneshot_mod_bits = MOD_BIT(KC_LEFT_CTRL) | MOD_BIT(KC_LEFT_ALT);
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FLASH_ALT, INDICATOR_STATE_ONESHOT);
-                } else if (keycode == KC_SUPERGUI) {
-                    composite_oneshot_mod_bits = MOD_BIT(KC_LEFT_CTRL) | MOD_BIT(KC_LEFT_GUI);
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FLASH_GUI, INDICATOR_STATE_ONESHOT);
-                }
-                return false;
-            }
+        case FSM_ACTION_UTIL_ONESHOT_BITWIG:
+            bitwig_mode_toggle();
+            // rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_CTRL, base_indicator_state());
+            transition_to_neutral();
             return false;
 
-        case FSM_UTIL_ONESHOT_ACTIVE:
-            if (!record->event.pressed) {
-                rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_CTRL, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
-                transition_to_neutral();
-                return false;
-            }
+        case FSM_ACTION_UTIL_ONESHOT_COMPOSITE:
+            state = FSM_COMPOSITE_ONESHOT_WAITING;
+            hires_dragscroll_off();
+            mouse_passthrough_set_pointer_state(MOUSE_PASSTHROUGH_ALL_DEVICES, false, false);
+            mouse_watcher_off();
+            layer_off(LAYER_UTIL);
+            composite_oneshot_mod_bits = MOD_BIT(KC_LEFT_CTRL) | composite_oneshot_mods[keycode - KC_SUPERCTRL].mod_bit;
+            rgb_indicators_start_transition(composite_oneshot_mods[keycode - KC_SUPERCTRL].flash_transition, INDICATOR_STATE_ONESHOT);
             return false;
 
-        case FSM_DRAGSCROLL:
-            if (record->event.pressed && !IS_INVERSE_MOUSEKEY(keycode) && !IS_STATEMACHINE_KEY(keycode)) {
-                rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_CTRL, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
-                transition_to_neutral();
-                return false;
-            }
-            if (record->event.pressed && keycode == KC_SUPERCTRL) {
-                state = FSM_CTRL_HELD;
-                hires_dragscroll_off();
-                mouse_passthrough_set_pointer_state(false, false);
-                rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_CTRL, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
-                return false;
-            }
+        case FSM_ACTION_UTIL_ONESHOT_DRAGSCROLL:
+            state = FSM_DRAGSCROLL;
+            mouse_watcher_off();
+            layer_off(LAYER_UTIL);
+            return false;
+
+        case FSM_ACTION_DRAGSCROLL_CTRL:
+            state = FSM_CTRL_HELD;
+            hires_dragscroll_off();
+            mouse_passthrough_set_pointer_state(MOUSE_PASSTHROUGH_ALL_DEVICES, false, false);
+            rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_CTRL, base_indicator_state());
             return false;
 
         // --------------------------------------------------------------------
         // SUPERSHIFT
         // --------------------------------------------------------------------
 
-        case FSM_SHIFT_HELD:
-            if (!record->event.pressed && keycode == KC_SUPERSHIFT) {
-                transition_to_neutral();
-                return false;
-            }
-            if (record->event.pressed && IS_MODIFIABLE_KEY(keycode)) {
-                state = FSM_SHIFT_REGISTERED;
-                register_code(KC_LEFT_SHIFT);
-                return true;
-            }
-            if ((record->event.pressed && IS_INVERSE_MOUSEKEY_BUTTON(keycode) && !bitwig_mode_is_on) || IS_INVERSE_MOUSEKEY_WHEEL(keycode)) {
-                state = FSM_SHIFT_REGISTERED;
-                register_code(KC_LEFT_SHIFT);
-                mouse_buffer_on(MOUSE_BUFFER_DURATION);
-                return true;
-            }
-            if (record->event.pressed && IS_INVERSE_MOUSEKEY_BUTTON(keycode) && bitwig_mode_is_on) {
+        case FSM_ACTION_SHIFT_HELD_KEY:
+            state = FSM_SHIFT_REGISTERED;
+            register_code(KC_LEFT_SHIFT);
+            return true;
+
+        case FSM_ACTION_SHIFT_HELD_BUTTON:
+            if (bitwig_mode_is_on) {
                 state = FSM_MOUSE_AXIS_SNAPPING;
                 mouse_axis_snapping_on();
-                mouse_passthrough_set_pointer_state(true, true);
+                mouse_passthrough_set_pointer_filter(MOUSE_PASSTHROUGH_ALL_DEVICES, MOUSE_PASSTHROUGH_POINTER_FILTER_AXIS_SNAPPING);
+                mouse_passthrough_set_pointer_state(MOUSE_PASSTHROUGH_ALL_DEVICES, true, true);
                 mouse_buffer_on(MOUSE_BUFFER_DURATION);
                 return true;
             }
-            if (record->event.pressed && keycode == KC_SUPERCTRL) {
-                state = FSM_CTRL_SHIFT_REGISTERED;
-                register_code(KC_LEFT_CTRL);
-                register_code(KC_LEFT_SHIFT);
-                return false;
-            }
+            // fall through
+        case FSM_ACTION_SHIFT_HELD_WHEEL:
+            state = FSM_SHIFT_REGISTERED;
+            register_code(KC_LEFT_SHIFT);
+            mouse_buffer_on(MOUSE_BUFFER_DURATION);
+            return true;
+
+        case FSM_ACTION_AXIS_SNAPPING_BUTTON_RELEASE:
+            if (pointer_buttons_held) return true;
+            state = FSM_SHIFT_HELD;
+            mouse_axis_snapping_off();
+            mouse_passthrough_set_pointer_state(MOUSE_PASSTHROUGH_ALL_DEVICES, false, false);
+            return true;
+
+        case FSM_ACTION_ADD_CTRL_AND_SHIFT:
+            state = FSM_CTRL_SHIFT_REGISTERED;
+            register_code(KC_LEFT_CTRL);
+            register_code(KC_LEFT_SHIFT);
             return false;
 
-        case FSM_SHIFT_REGISTERED:
-            if (IS_MODIFIABLE_KEY(keycode) || IS_INVERSE_MOUSEKEY(keycode)) {
-                return true;
-            }
-            if (!record->event.pressed && keycode == KC_SUPERSHIFT) {
-                transition_to_neutral();
-                return false;
-            }
-            if (record->event.pressed && keycode == KC_SUPERCTRL) {
-                state = FSM_CTRL_SHIFT_REGISTERED;
-                register_code(KC_LEFT_CTRL);
-                return false;
-            }
+        case FSM_ACTION_ADD_CTRL:
+            state = FSM_CTRL_SHIFT_REGISTERED;
+            register_code(KC_LEFT_CTRL);
             return false;
 
-        case FSM_MOUSE_AXIS_SNAPPING:
-            if (record->event.pressed && IS_INVERSE_MOUSEKEY_BUTTON(keycode)) {
-                return true;
-            }
-            if (!record->event.pressed && IS_INVERSE_MOUSEKEY_BUTTON(keycode) && pointing_device_get_report().buttons != 0) {
-                return true;
-            }
-            if (!record->event.pressed && keycode == KC_SUPERSHIFT) {
-                transition_to_neutral();
-                return false;
-            }
-            if (!record->event.pressed && IS_INVERSE_MOUSEKEY_BUTTON(keycode) && pointing_device_get_report().buttons == 0) {
-                state = FSM_SHIFT_HELD;
-                mouse_axis_snapping_off();
-                mouse_passthrough_set_pointer_state(false, false);
-                return true;
-            }
+        case FSM_ACTION_ADD_SHIFT:
+            state = FSM_CTRL_SHIFT_REGISTERED;
+            register_code(KC_LEFT_SHIFT);
             return false;
 
-        case FSM_CTRL_SHIFT_REGISTERED:
-            if (IS_MODIFIABLE_KEY(keycode) || IS_INVERSE_MOUSEKEY(keycode)) {
-                return true;
-            }
-            if (!record->event.pressed && keycode == KC_SUPERSHIFT) {
-                state = FSM_CTRL_REGISTERED;
-                unregister_code(KC_LEFT_SHIFT);
-                return false;
-            }
-            if (!record->event.pressed && keycode == KC_SUPERCTRL) {
-                state = FSM_SHIFT_REGISTERED;
-                unregister_code(KC_LEFT_CTRL);
-                return false;
-            }
+        case FSM_ACTION_REMOVE_CTRL:
+            state = FSM_SHIFT_REGISTERED;
+            unregister_code(KC_LEFT_CTRL);
+            return false;
+
+        case FSM_ACTION_REMOVE_SHIFT:
+            state = FSM_CTRL_REGISTERED;
+            unregister_code(KC_LEFT_SHIFT);
             return false;
 
         // --------------------------------------------------------------------
         // SUPERALT
         // --------------------------------------------------------------------
 
-        case FSM_ALT_TAPPED:
-            if (record->event.pressed && (keycode == KC_SUPERCTRL || keycode == KC_SUPERGUI)) {
-                transition_to_neutral();
-                return process_record_eynsai_statemachine(keycode, record);
-            }
-            if (keycode == KC_TIMEOUT_EVENT) {
-                state = FSM_ALT_HELD;
-                return false;
-            }
-            if (record->event.pressed && IS_INVERSE_MOUSEKEY_BUTTON(keycode)) {
-                state = FSM_ALT_REGISTERED;
-                simple_timer_off();
-                layer_off(LAYER_MOVE);
-                register_code(KC_LEFT_ALT);
-                mouse_buffer_on(MOUSE_BUFFER_DURATION);
-                return true;
-            }
-            if (record->event.pressed && !IS_INVERSE_MOUSEKEY(keycode) && !IS_STATEMACHINE_KEY(keycode)) {
-                state = FSM_MOVE_MOMENTARY;
-                simple_timer_off();
-                return true;
-            }
-            if (IS_INVERSE_MOUSEKEY_WHEEL(keycode)) {
-                state = FSM_MOVE_MOMENTARY;
-                simple_timer_off();
-                tap_code(keycode == KC_INV_MOUSEKEY_WHEEL_UP ? KC_UP : keycode == KC_INV_MOUSEKEY_WHEEL_DOWN ? KC_DOWN : keycode == KC_INV_MOUSEKEY_WHEEL_LEFT ? KC_LEFT : KC_RIGHT);
-                return false;
-            }
-            if (!record->event.pressed && keycode == KC_SUPERALT) {
-                state = FSM_COMPOSITE_ONESHOT_WAITING;
-                simple_timer_off();
-                layer_off(LAYER_MOVE);
-                composite_oneshot_mod_bits = MOD_BIT(KC_LEFT_ALT);
-                rgb_indicators_start_transition(INDICATOR_TRANSITION_TO_ALT, INDICATOR_STATE_ONESHOT);
-                return false;
-            }
+        case FSM_ACTION_ALT_TAPPED_TIMEOUT:
+            state = FSM_ALT_HELD;
             return false;
 
-        case FSM_ALT_HELD:
-            if (!record->event.pressed && keycode == KC_SUPERALT) {
-                transition_to_neutral();
-                return false;
-            }
-            if (record->event.pressed && (keycode == KC_SUPERCTRL || keycode == KC_SUPERGUI)) {
-                transition_to_neutral();
-                return process_record_eynsai_statemachine(keycode, record);
-            }
-            if (record->event.pressed && IS_INVERSE_MOUSEKEY_BUTTON(keycode)) {
-                state = FSM_ALT_REGISTERED;
-                layer_off(LAYER_MOVE);
-                register_code(KC_LEFT_ALT);
-                mouse_buffer_on(MOUSE_BUFFER_DURATION);
-                return true;
-            }
-            if (record->event.pressed && !IS_INVERSE_MOUSEKEY(keycode) && !IS_STATEMACHINE_KEY(keycode)) {
-                state = FSM_MOVE_MOMENTARY;
-                return true;
-            }
-            if (IS_INVERSE_MOUSEKEY_WHEEL(keycode)) {
-                state = FSM_MOVE_MOMENTARY;
-                tap_code(keycode == KC_INV_MOUSEKEY_WHEEL_UP ? KC_UP : keycode == KC_INV_MOUSEKEY_WHEEL_DOWN ? KC_DOWN : keycode == KC_INV_MOUSEKEY_WHEEL_LEFT ? KC_LEFT : KC_RIGHT);
-                return false;
-            }
-            return false;
+        case FSM_ACTION_ALT_TAPPED_KEY:
+            simple_timer_off();
+            // fall through
+        case FSM_ACTION_ALT_HELD_KEY:
+            state = FSM_MOVE_MOMENTARY;
+            return true;
 
-        case FSM_MOVE_MOMENTARY:
-            if (!IS_INVERSE_MOUSEKEY(keycode) && !IS_STATEMACHINE_KEY(keycode)) {
-                return true;
-            }
-            if (IS_INVERSE_MOUSEKEY_WHEEL(keycode)) {
-                tap_code(keycode == KC_INV_MOUSEKEY_WHEEL_UP ? KC_UP : keycode == KC_INV_MOUSEKEY_WHEEL_DOWN ? KC_DOWN : keycode == KC_INV_MOUSEKEY_WHEEL_LEFT ? KC_LEFT : KC_RIGHT);
-                return false;
-            }
-            if (!record->event.pressed && keycode == KC_SUPERALT) {
-                transition_to_neutral();
-                return false;
-            }
-            if (record->event.pressed && (keycode == KC_SUPERCTRL || keycode == KC_SUPERGUI)) {
-                transition_to_neutral();
-                return process_record_eynsai_statemachine(keycode, record);
-            }
+        case FSM_ACTION_ALT_TAPPED_BUTTON:
+            simple_timer_off();
+            // fall through
+        case FSM_ACTION_ALT_HELD_BUTTON:
+            state = FSM_ALT_REGISTERED;
+            layer_off(LAYER_MOVE);
+            register_code(KC_LEFT_ALT);
+            mouse_buffer_on(MOUSE_BUFFER_DURATION);
+            return true;
+
+        case FSM_ACTION_ALT_TAPPED_WHEEL:
+            simple_timer_off();
+            // fall through
+        case FSM_ACTION_ALT_HELD_WHEEL:
+            state = FSM_MOVE_MOMENTARY;
+            // fall through
+        case FSM_ACTION_MOVE_WHEEL:
+            tap_wheel_as_arrow(keycode);
             return false;
 
-        case FSM_ALT_REGISTERED:
-            if (IS_MODIFIABLE_KEY(keycode)) {
-                return true;
-            }
-            if (IS_INVERSE_MOUSEKEY(keycode)) {
-                return true;
-            }
-            if (!record->event.pressed && keycode == KC_SUPERALT) {
-                transition_to_neutral();
-                return false;
-            }
-            if (record->event.pressed && (keycode == KC_SUPERCTRL || keycode == KC_SUPERGUI)) {
-                transition_to_neutral();
-                return process_record_eynsai_statemachine(keycode, record);
-            }
+        case FSM_ACTION_ALT_TAPPED_RELEASE:
+            state = FSM_COMPOSITE_ONESHOT_WAITING;
+            simple_timer_off();
+            layer_off(LAYER_MOVE);
+            composite_oneshot_mod_bits = MOD_BIT(KC_LEFT_ALT);
+            rgb_indicators_start_transition(INDICATOR_TRANSITION_TO_ALT, INDICATOR_STATE_ONESHOT);
             return false;
 
         // --------------------------------------------------------------------
         // SUPERGUI
         // --------------------------------------------------------------------
 
-        case FSM_GUI_AMBIGUOUS:
-            if (record->event.pressed && (keycode == KC_SUPERCTRL || keycode == KC_SUPERALT)) {
-                transition_to_neutral();
-                return process_record_eynsai_statemachine(keycode, record);
-            }
-            if (keycode == KC_TIMEOUT_EVENT) {
-                state = FSM_GUI_HELD;
-                return false;
-            }
-            if (record->event.pressed && !IS_INVERSE_MOUSEKEY(keycode) && !IS_STATEMACHINE_KEY(keycode)) {
-                state = FSM_FUNC_MOMENTARY;
-                simple_timer_off();
-                return true;
-            }
-            if (!record->event.pressed && keycode == KC_SUPERGUI) {
-                state = FSM_COMPOSITE_ONESHOT_WAITING;
-                simple_timer_off();
-                layer_off(LAYER_FUNC);
-                composite_oneshot_mod_bits = MOD_BIT(KC_LEFT_GUI);
-                rgb_indicators_start_transition(INDICATOR_TRANSITION_TO_GUI, INDICATOR_STATE_ONESHOT);
-                return false;
-            }
+        case FSM_ACTION_GUI_AMBIGUOUS_TIMEOUT:
+            state = FSM_GUI_HELD;
             return false;
 
-        case FSM_GUI_HELD:
-            if (!record->event.pressed && keycode == KC_SUPERGUI) {
-                transition_to_neutral();
-                return false;
-            }
-            if (record->event.pressed && (keycode == KC_SUPERCTRL || keycode == KC_SUPERALT)) {
-                transition_to_neutral();
-                return process_record_eynsai_statemachine(keycode, record);
-            }
-            if (record->event.pressed && !IS_INVERSE_MOUSEKEY(keycode) && !IS_STATEMACHINE_KEY(keycode)) {
-                state = FSM_FUNC_MOMENTARY;
-                return true;
-            }
-            return false;
+        case FSM_ACTION_GUI_AMBIGUOUS_KEY:
+            simple_timer_off();
+            // fall through
+        case FSM_ACTION_GUI_HELD_KEY:
+            state = FSM_FUNC_MOMENTARY;
+            return true;
 
-        case FSM_FUNC_MOMENTARY:
-            if (!IS_INVERSE_MOUSEKEY(keycode) && !IS_STATEMACHINE_KEY(keycode)) {
-                return true;
-            }
-            if (!record->event.pressed && keycode == KC_SUPERGUI) {
-                transition_to_neutral();
-                return false;
-            }
-            if (record->event.pressed && (keycode == KC_SUPERCTRL || keycode == KC_SUPERALT)) {
-                transition_to_neutral();
-                return process_record_eynsai_statemachine(keycode, record);
-            }
+        case FSM_ACTION_GUI_AMBIGUOUS_RELEASE:
+            state = FSM_COMPOSITE_ONESHOT_WAITING;
+            simple_timer_off();
+            layer_off(LAYER_FUNC);
+            composite_oneshot_mod_bits = MOD_BIT(KC_LEFT_GUI);
+            rgb_indicators_start_transition(INDICATOR_TRANSITION_TO_GUI, INDICATOR_STATE_ONESHOT);
             return false;
 
         // --------------------------------------------------------------------
         // COMPOSITE ONESHOT
         // --------------------------------------------------------------------
 
-        case FSM_COMPOSITE_ONESHOT_WAITING:
-            if (record->event.pressed && IS_MODIFIABLE_KEY(keycode)) {
-                state = FSM_COMPOSITE_ONESHOT_ACTIVE;
-                register_mods(composite_oneshot_mod_bits);
-                return true;
-            }
-            if (record->event.pressed && keycode == KC_SUPERCTRL) {
-                if ((composite_oneshot_mod_bits & MOD_BIT(KC_LEFT_CTRL)) == 0) {
-                    composite_oneshot_mod_bits |= MOD_BIT(KC_LEFT_CTRL);
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FLASH_CTRL, INDICATOR_STATE_ONESHOT);
-                } else if (composite_oneshot_mod_bits == MOD_BIT(KC_LEFT_CTRL)) {
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_CTRL, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
-                    transition_to_neutral();
-                } else {
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_MULTIPLE, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
-                    transition_to_neutral();
-                }
-                return false;
-            }
-            if (record->event.pressed && keycode == KC_SUPERSHIFT) {
-                if ((composite_oneshot_mod_bits & MOD_BIT(KC_LEFT_SHIFT)) == 0) {
-                    composite_oneshot_mod_bits |= MOD_BIT(KC_LEFT_SHIFT);
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FLASH_SHIFT, INDICATOR_STATE_ONESHOT);
-
-                // NOTE: won't ever enter this clause
-                } else if (composite_oneshot_mod_bits == MOD_BIT(KC_LEFT_SHIFT)) {
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_SHIFT, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
-                    transition_to_neutral();
-
-                } else {
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_MULTIPLE, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
-                    transition_to_neutral();
-                }
-                return false;
-            }
-            if (record->event.pressed && keycode == KC_SUPERALT) {
-                if ((composite_oneshot_mod_bits & MOD_BIT(KC_LEFT_ALT)) == 0) {
-                    composite_oneshot_mod_bits |= MOD_BIT(KC_LEFT_ALT);
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FLASH_ALT, INDICATOR_STATE_ONESHOT);
-                } else if (composite_oneshot_mod_bits == MOD_BIT(KC_LEFT_ALT)) {
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_ALT, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
-                    transition_to_neutral();
-                } else {
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_MULTIPLE, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
-                    transition_to_neutral();
-                }
-                return false;
-            }
-            if (record->event.pressed && keycode == KC_SUPERGUI) {
-                if ((composite_oneshot_mod_bits & MOD_BIT(KC_LEFT_GUI)) == 0) {
-                    composite_oneshot_mod_bits |= MOD_BIT(KC_LEFT_GUI);
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FLASH_GUI, INDICATOR_STATE_ONESHOT);
-                } else if (composite_oneshot_mod_bits == MOD_BIT(KC_LEFT_GUI)) {
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_GUI, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
-                    transition_to_neutral();
-                } else {
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_MULTIPLE, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
-                    transition_to_neutral();
-                }
-                return false;
-            }
-            return false;
+        case FSM_ACTION_COMPOSITE_ONESHOT_KEY:
+            state = FSM_COMPOSITE_ONESHOT_ACTIVE;
+            register_mods(composite_oneshot_mod_bits);
+            return true;
+
+        case FSM_ACTION_COMPOSITE_ONESHOT_MOD: {
+            uint8_t mod_bit = composite_oneshot_mods[keycode - KC_SUPERCTRL].mod_bit;
+            if ((composite_oneshot_mod_bits & mod_bit) == 0) {
+                composite_oneshot_mod_bits |= mod_bit;
+                rgb_indicators_start_transition(composite_oneshot_mods[keycode - KC_SUPERCTRL].flash_transition, INDICATOR_STATE_ONESHOT);
 
-        case FSM_COMPOSITE_ONESHOT_ACTIVE:
-            if (!record->event.pressed) {
-                if (composite_oneshot_mod_bits == MOD_BIT(KC_LEFT_CTRL)) {
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_CTRL, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
-                } else if (composite_oneshot_mod_bits == MOD_BIT(KC_LEFT_ALT)) {
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_ALT, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
-                } else if (composite_oneshot_mod_bits == MOD_BIT(KC_LEFT_GUI)) {
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_GUI, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
-                } else {
-                    rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_MULTIPLE, (base_layer == LAYER_WORK ? INDICATOR_STATE_OFF : INDICATOR_STATE_BASE));
-                }
+            // NOTE: never entered for supershift, composites don't start from shift alone
+            } else if (composite_oneshot_mod_bits == mod_bit) {
+                rgb_indicators_start_transition(composite_oneshot_mods[keycode - KC_SUPERCTRL].from_transition, base_indicator_state());
+                transition_to_neutral();
+
+            } else {
+                rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_MULTIPLE, base_indicator_state());
                 transition_to_neutral();
-                return false;
             }
             return false;
+        }
+
+        case FSM_ACTION_COMPOSITE_ONESHOT_EXIT:
+            if (composite_oneshot_mod_bits == MOD_BIT(KC_LEFT_CTRL)) {
+                rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_CTRL, base_indicator_state());
+            } else if (composite_oneshot_mod_bits == MOD_BIT(KC_LEFT_ALT)) {
+                rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_ALT, base_indicator_state());
+            } else if (composite_oneshot_mod_bits == MOD_BIT(KC_LEFT_GUI)) {
+                rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_GUI, base_indicator_state());
+            } else {
+                rgb_indicators_start_transition(INDICATOR_TRANSITION_FROM_MULTIPLE, base_indicator_state());
+            }
+            transition_to_neutral();
+            return false;
 
         // --------------------------------------------------------------------
         // BASE
         // --------------------------------------------------------------------
-        
-        case FSM_BASE_AMBIGUOUS:
-            if (keycode == KC_TIMEOUT_EVENT) {
-                state = FSM_NEUTRAL;
-                base_layer = LAYER_GAME;
-                layer_off(LAYER_QWER);
-                layer_on(LAYER_GAME);
-                rgb_indicators_start_transition(INDICATOR_TRANSITION_TO_GAME, INDICATOR_STATE_BASE);
-                transition_to_neutral();
-                return false;
-            }
-            if (!record->event.pressed && keycode == KC_BASE) {
-                state = FSM_NEUTRAL;
-                base_layer = LAYER_QWER;
-                layer_on(LAYER_QWER);
-                layer_off(LAYER_GAME);
-                rgb_indicators_start_transition(INDICATOR_TRANSITION_TO_QWER, INDICATOR_STATE_BASE);
-                transition_to_neutral();
-                return false;
-            }
+
+        case FSM_ACTION_BASE_TIMEOUT:
+            state = FSM_NEUTRAL;
+            base_layer = LAYER_GAME;
+            layer_off(LAYER_QWER);
+            layer_on(LAYER_GAME);
+            rgb_indicators_start_transition(INDICATOR_TRANSITION_TO_GAME, INDICATOR_STATE_BASE);
+            transition_to_neutral();
+            return false;
+
+        case FSM_ACTION_BASE_RELEASE:
+            state = FSM_NEUTRAL;
+            base_layer = LAYER_QWER;
+            layer_on(LAYER_QWER);
+            layer_off(LAYER_GAME);
+            rgb_indicators_start_transition(INDICATOR_TRANSITION_TO_QWER, INDICATOR_STATE_BASE);
+            transition_to_neutral();
             return false;
 
         // shouldn't ever need this
         default:
             return true;
-    }       
+    }
+}
+
+// ============================================================================
+// TRANSITION TABLE
+// ============================================================================
+
+// the action taken for every (state, event) pair, events that aren't listed in a state are blocked (FSM_ACTION_BLOCK is zero)
+static const uint8_t fsm_transitions[FSM_NODE_COUNT][FSM_EVENT_COUNT] = {
+
+    [FSM_NEUTRAL] = {
+        [FSM_EVENT_SUPERCTRL_PRESS]         = FSM_ACTION_SUPERCTRL,
+        [FSM_EVENT_SUPERSHIFT_PRESS]        = FSM_ACTION_SUPERSHIFT,
+        [FSM_EVENT_SUPERALT_PRESS]          = FSM_ACTION_SUPERALT,
+        [FSM_EVENT_SUPERGUI_PRESS]          = FSM_ACTION_SUPERGUI,
+        [FSM_EVENT_BASE_PRESS]              = FSM_ACTION_BASE,
+        [FSM_EVENT_SUPERCTRL_RELEASE]       = FSM_ACTION_PASS,
+        [FSM_EVENT_SUPERSHIFT_RELEASE]      = FSM_ACTION_PASS,
+        [FSM_EVENT_SUPERALT_RELEASE]        = FSM_ACTION_PASS,
+        [FSM_EVENT_SUPERGUI_RELEASE]        = FSM_ACTION_PASS,
+        [FSM_EVENT_BITWIG_RELEASE]          = FSM_ACTION_PASS,
+        [FSM_EVENT_BITWIG_PRESS]            = FSM_ACTION_PASS,
+        [FSM_EVENT_BASE_RELEASE]            = FSM_ACTION_PASS,
+        [FSM_EVENT_TIMEOUT_RELEASE]         = FSM_ACTION_PASS,
+        [FSM_EVENT_TIMEOUT_PRESS]           = FSM_ACTION_PASS,
+        [FSM_EVENT_MOUSE_WATCHER_RELEASE]   = FSM_ACTION_PASS,
+        [FSM_EVENT_MOUSE_WATCHER_PRESS]     = FSM_ACTION_PASS,
+        [FSM_EVENT_BUTTON_RELEASE]          = FSM_ACTION_PASS,
+        [FSM_EVENT_BUTTON_PRESS]            = FSM_ACTION_PASS,
+        [FSM_EVENT_WHEEL_RELEASE]           = FSM_ACTION_PASS,
+        [FSM_EVENT_WHEEL_PRESS]             = FSM_ACTION_PASS,
+        [FSM_EVENT_KEY_RELEASE]             = FSM_ACTION_PASS,
+        [FSM_EVENT_KEY_PRESS]               = FSM_ACTION_PASS,
+        [FSM_EVENT_OTHER_RELEASE]           = FSM_ACTION_PASS,
+        [FSM_EVENT_OTHER_PRESS]             = FSM_ACTION_PASS,
+    },
+
+    // ------------------------------------------------------------------------
+    // SUPERCTRL
+    // ------------------------------------------------------------------------
+
+    [FSM_CTRL_TAPPED] = {
+        [FSM_EVENT_SUPERCTRL_RELEASE]       = FSM_ACTION_CTRL_TAPPED_RELEASE,
+        [FSM_EVENT_SUPERALT_PRESS]          = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_SUPERGUI_PRESS]          = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_TIMEOUT_RELEASE]         = FSM_ACTION_CTRL_TAPPED_TIMEOUT,
+        [FSM_EVENT_TIMEOUT_PRESS]           = FSM_ACTION_CTRL_TAPPED_TIMEOUT,
+        [FSM_EVENT_BUTTON_PRESS]            = FSM_ACTION_CTRL_TAPPED_BUTTON,
+        [FSM_EVENT_WHEEL_RELEASE]           = FSM_ACTION_CTRL_TAPPED_WHEEL,
+        [FSM_EVENT_WHEEL_PRESS]             = FSM_ACTION_CTRL_TAPPED_WHEEL,
+        [FSM_EVENT_KEY_PRESS]               = FSM_ACTION_CTRL_TAPPED_KEY,
+    },
+
+    [FSM_CTRL_HELD] = {
+        [FSM_EVENT_SUPERCTRL_RELEASE]       = FSM_ACTION_NEUTRAL,
+        [FSM_EVENT_SUPERSHIFT_PRESS]        = FSM_ACTION_ADD_CTRL_AND_SHIFT,
+        [FSM_EVENT_SUPERALT_PRESS]          = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_SUPERGUI_PRESS]          = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_BUTTON_PRESS]            = FSM_ACTION_CTRL_HELD_BUTTON,
+        [FSM_EVENT_WHEEL_RELEASE]           = FSM_ACTION_CTRL_HELD_WHEEL,
+        [FSM_EVENT_WHEEL_PRESS]             = FSM_ACTION_CTRL_HELD_WHEEL,
+        [FSM_EVENT_KEY_PRESS]               = FSM_ACTION_CTRL_HELD_KEY,
+    },
+
+    [FSM_CTRL_REGISTERED] = {
+        [FSM_EVENT_SUPERCTRL_RELEASE]       = FSM_ACTION_NEUTRAL,
+        [FSM_EVENT_SUPERSHIFT_PRESS]        = FSM_ACTION_ADD_SHIFT,
+        [FSM_EVENT_SUPERALT_PRESS]          = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_SUPERGUI_PRESS]          = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_BUTTON_RELEASE]          = FSM_ACTION_PASS,
+        [FSM_EVENT_BUTTON_PRESS]            = FSM_ACTION_PASS,
+        [FSM_EVENT_WHEEL_RELEASE]           = FSM_ACTION_PASS,
+        [FSM_EVENT_WHEEL_PRESS]             = FSM_ACTION_PASS,
+        [FSM_EVENT_KEY_RELEASE]             = FSM_ACTION_PASS,
+        [FSM_EVENT_KEY_PRESS]               = FSM_ACTION_PASS,
+    },
+
+    // NOTE: opportunity to do something with the mouse buttons and wheels here; they're pretty ergonomic
+    [FSM_UTIL_ONESHOT_WAITING] = {
+        [FSM_EVENT_SUPERCTRL_PRESS]         = FSM_ACTION_UTIL_ONESHOT_EXIT,
+        [FSM_EVENT_SUPERSHIFT_PRESS]        = FSM_ACTION_UTIL_ONESHOT_COMPOSITE,
+        [FSM_EVENT_SUPERALT_PRESS]          = FSM_ACTION_UTIL_ONESHOT_COMPOSITE,
+        [FSM_EVENT_SUPERGUI_PRESS]          = FSM_ACTION_UTIL_ONESHOT_COMPOSITE,
+        [FSM_EVENT_BITWIG_PRESS]            = FSM_ACTION_UTIL_ONESHOT_BITWIG,
+        [FSM_EVENT_MOUSE_WATCHER_RELEASE]   = FSM_ACTION_UTIL_ONESHOT_DRAGSCROLL,
+        [FSM_EVENT_MOUSE_WATCHER_PRESS]     = FSM_ACTION_UTIL_ONESHOT_DRAGSCROLL,
+        [FSM_EVENT_KEY_PRESS]               = FSM_ACTION_UTIL_ONESHOT_KEY,
+        [FSM_EVENT_OTHER_PRESS]             = FSM_ACTION_UTIL_ONESHOT_KEY,
+    },
+
+    [FSM_UTIL_ONESHOT_ACTIVE] = {
+        [FSM_EVENT_SUPERCTRL_RELEASE]       = FSM_ACTION_UTIL_ONESHOT_EXIT,
+        [FSM_EVENT_SUPERSHIFT_RELEASE]      = FSM_ACTION_UTIL_ONESHOT_EXIT,
+        [FSM_EVENT_SUPERALT_RELEASE]        = FSM_ACTION_UTIL_ONESHOT_EXIT,
+        [FSM_EVENT_SUPERGUI_RELEASE]        = FSM_ACTION_UTIL_ONESHOT_EXIT,
+        [FSM_EVENT_BITWIG_RELEASE]          = FSM_ACTION_UTIL_ONESHOT_EXIT,
+        [FSM_EVENT_BASE_RELEASE]            = FSM_ACTION_UTIL_ONESHOT_EXIT,
+        [FSM_EVENT_TIMEOUT_RELEASE]         = FSM_ACTION_UTIL_ONESHOT_EXIT,
+        [FSM_EVENT_MOUSE_WATCHER_RELEASE]   = FSM_ACTION_UTIL_ONESHOT_EXIT,
+        [FSM_EVENT_BUTTON_RELEASE]          = FSM_ACTION_UTIL_ONESHOT_EXIT,
+        [FSM_EVENT_WHEEL_RELEASE]           = FSM_ACTION_UTIL_ONESHOT_EXIT,
+        [FSM_EVENT_KEY_RELEASE]             = FSM_ACTION_UTIL_ONESHOT_EXIT,
+        [FSM_EVENT_OTHER_RELEASE]           = FSM_ACTION_UTIL_ONESHOT_EXIT,
+    },
+
+    [FSM_DRAGSCROLL] = {
+        [FSM_EVENT_SUPERCTRL_PRESS]         = FSM_ACTION_DRAGSCROLL_CTRL,
+        [FSM_EVENT_KEY_PRESS]               = FSM_ACTION_UTIL_ONESHOT_EXIT,
+        [FSM_EVENT_OTHER_PRESS]             = FSM_ACTION_UTIL_ONESHOT_EXIT,
+    },
+
+    // ------------------------------------------------------------------------
+    // SUPERSHIFT
+    // ------------------------------------------------------------------------
+
+    [FSM_SHIFT_HELD] = {
+        [FSM_EVENT_SUPERCTRL_PRESS]         = FSM_ACTION_ADD_CTRL_AND_SHIFT,
+        [FSM_EVENT_SUPERSHIFT_RELEASE]      = FSM_ACTION_NEUTRAL,
+        [FSM_EVENT_BUTTON_PRESS]            = FSM_ACTION_SHIFT_HELD_BUTTON,
+        [FSM_EVENT_WHEEL_RELEASE]           = FSM_ACTION_SHIFT_HELD_WHEEL,
+        [FSM_EVENT_WHEEL_PRESS]             = FSM_ACTION_SHIFT_HELD_WHEEL,
+        [FSM_EVENT_KEY_PRESS]               = FSM_ACTION_SHIFT_HELD_KEY,
+    },
+
+    [FSM_SHIFT_REGISTERED] = {
+        [FSM_EVENT_SUPERCTRL_PRESS]         = FSM_ACTION_ADD_CTRL,
+        [FSM_EVENT_SUPERSHIFT_RELEASE]      = FSM_ACTION_NEUTRAL,
+        [FSM_EVENT_BUTTON_RELEASE]          = FSM_ACTION_PASS,
+        [FSM_EVENT_BUTTON_PRESS]            = FSM_ACTION_PASS,
+        [FSM_EVENT_WHEEL_RELEASE]           = FSM_ACTION_PASS,
+        [FSM_EVENT_WHEEL_PRESS]             = FSM_ACTION_PASS,
+        [FSM_EVENT_KEY_RELEASE]             = FSM_ACTION_PASS,
+        [FSM_EVENT_KEY_PRESS]               = FSM_ACTION_PASS,
+    },
+
+    [FSM_MOUSE_AXIS_SNAPPING] = {
+        [FSM_EVENT_SUPERSHIFT_RELEASE]      = FSM_ACTION_NEUTRAL,
+        [FSM_EVENT_BUTTON_RELEASE]          = FSM_ACTION_AXIS_SNAPPING_BUTTON_RELEASE,
+        [FSM_EVENT_BUTTON_PRESS]            = FSM_ACTION_PASS,
+    },
+
+    [FSM_CTRL_SHIFT_REGISTERED] = {
+        [FSM_EVENT_SUPERCTRL_RELEASE]       = FSM_ACTION_REMOVE_CTRL,
+        [FSM_EVENT_SUPERSHIFT_RELEASE]      = FSM_ACTION_REMOVE_SHIFT,
+        [FSM_EVENT_BUTTON_RELEASE]          = FSM_ACTION_PASS,
+        [FSM_EVENT_BUTTON_PRESS]            = FSM_ACTION_PASS,
+        [FSM_EVENT_WHEEL_RELEASE]           = FSM_ACTION_PASS,
+        [FSM_EVENT_WHEEL_PRESS]             = FSM_ACTION_PASS,
+        [FSM_EVENT_KEY_RELEASE]             = FSM_ACTION_PASS,
+        [FSM_EVENT_KEY_PRESS]               = FSM_ACTION_PASS,
+    },
+
+    // ------------------------------------------------------------------------
+    // SUPERALT
+    // ------------------------------------------------------------------------
+
+    [FSM_ALT_TAPPED] = {
+        [FSM_EVENT_SUPERCTRL_PRESS]         = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_SUPERALT_RELEASE]        = FSM_ACTION_ALT_TAPPED_RELEASE,
+        [FSM_EVENT_SUPERGUI_PRESS]          = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_TIMEOUT_RELEASE]         = FSM_ACTION_ALT_TAPPED_TIMEOUT,
+        [FSM_EVENT_TIMEOUT_PRESS]           = FSM_ACTION_ALT_TAPPED_TIMEOUT,
+        [FSM_EVENT_BUTTON_PRESS]            = FSM_ACTION_ALT_TAPPED_BUTTON,
+        [FSM_EVENT_WHEEL_RELEASE]           = FSM_ACTION_ALT_TAPPED_WHEEL,
+        [FSM_EVENT_WHEEL_PRESS]             = FSM_ACTION_ALT_TAPPED_WHEEL,
+        [FSM_EVENT_KEY_PRESS]               = FSM_ACTION_ALT_TAPPED_KEY,
+        [FSM_EVENT_OTHER_PRESS]             = FSM_ACTION_ALT_TAPPED_KEY,
+    },
+
+    [FSM_ALT_HELD] = {
+        [FSM_EVENT_SUPERCTRL_PRESS]         = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_SUPERALT_RELEASE]        = FSM_ACTION_NEUTRAL,
+        [FSM_EVENT_SUPERGUI_PRESS]          = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_BUTTON_PRESS]            = FSM_ACTION_ALT_HELD_BUTTON,
+        [FSM_EVENT_WHEEL_RELEASE]           = FSM_ACTION_ALT_HELD_WHEEL,
+        [FSM_EVENT_WHEEL_PRESS]             = FSM_ACTION_ALT_HELD_WHEEL,
+        [FSM_EVENT_KEY_PRESS]               = FSM_ACTION_ALT_HELD_KEY,
+        [FSM_EVENT_OTHER_PRESS]             = FSM_ACTION_ALT_HELD_KEY,
+    },
+
+    [FSM_ALT_REGISTERED] = {
+        [FSM_EVENT_SUPERCTRL_PRESS]         = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_SUPERALT_RELEASE]        = FSM_ACTION_NEUTRAL,
+        [FSM_EVENT_SUPERGUI_PRESS]          = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_BUTTON_RELEASE]          = FSM_ACTION_PASS,
+        [FSM_EVENT_BUTTON_PRESS]            = FSM_ACTION_PASS,
+        [FSM_EVENT_WHEEL_RELEASE]           = FSM_ACTION_PASS,
+        [FSM_EVENT_WHEEL_PRESS]             = FSM_ACTION_PASS,
+        [FSM_EVENT_KEY_RELEASE]             = FSM_ACTION_PASS,
+        [FSM_EVENT_KEY_PRESS]               = FSM_ACTION_PASS,
+    },
+
+    [FSM_MOVE_MOMENTARY] = {
+        [FSM_EVENT_SUPERCTRL_PRESS]         = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_SUPERALT_RELEASE]        = FSM_ACTION_NEUTRAL,
+        [FSM_EVENT_SUPERGUI_PRESS]          = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_WHEEL_RELEASE]           = FSM_ACTION_MOVE_WHEEL,
+        [FSM_EVENT_WHEEL_PRESS]             = FSM_ACTION_MOVE_WHEEL,
+        [FSM_EVENT_KEY_RELEASE]             = FSM_ACTION_PASS,
+        [FSM_EVENT_KEY_PRESS]               = FSM_ACTION_PASS,
+        [FSM_EVENT_OTHER_RELEASE]           = FSM_ACTION_PASS,
+        [FSM_EVENT_OTHER_PRESS]             = FSM_ACTION_PASS,
+    },
+
+    // ------------------------------------------------------------------------
+    // SUPERGUI
+    // ------------------------------------------------------------------------
+
+    [FSM_GUI_AMBIGUOUS] = {
+        [FSM_EVENT_SUPERCTRL_PRESS]         = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_SUPERALT_PRESS]          = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_SUPERGUI_RELEASE]        = FSM_ACTION_GUI_AMBIGUOUS_RELEASE,
+        [FSM_EVENT_TIMEOUT_RELEASE]         = FSM_ACTION_GUI_AMBIGUOUS_TIMEOUT,
+        [FSM_EVENT_TIMEOUT_PRESS]           = FSM_ACTION_GUI_AMBIGUOUS_TIMEOUT,
+        [FSM_EVENT_KEY_PRESS]               = FSM_ACTION_GUI_AMBIGUOUS_KEY,
+        [FSM_EVENT_OTHER_PRESS]             = FSM_ACTION_GUI_AMBIGUOUS_KEY,
+    },
+
+    [FSM_GUI_HELD] = {
+        [FSM_EVENT_SUPERCTRL_PRESS]         = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_SUPERALT_PRESS]          = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_SUPERGUI_RELEASE]        = FSM_ACTION_NEUTRAL,
+        [FSM_EVENT_KEY_PRESS]               = FSM_ACTION_GUI_HELD_KEY,
+        [FSM_EVENT_OTHER_PRESS]             = FSM_ACTION_GUI_HELD_KEY,
+    },
+
+    [FSM_FUNC_MOMENTARY] = {
+        [FSM_EVENT_SUPERCTRL_PRESS]         = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_SUPERALT_PRESS]          = FSM_ACTION_NEUTRAL_AND_RETRY,
+        [FSM_EVENT_SUPERGUI_RELEASE]        = FSM_ACTION_NEUTRAL,
+        [FSM_EVENT_KEY_RELEASE]             = FSM_ACTION_PASS,
+        [FSM_EVENT_KEY_PRESS]               = FSM_ACTION_PASS,
+        [FSM_EVENT_OTHER_RELEASE]           = FSM_ACTION_PASS,
+        [FSM_EVENT_OTHER_PRESS]             = FSM_ACTION_PASS,
+    },
+
+    // ------------------------------------------------------------------------
+    // COMPOSITE ONESHOT
+    // ------------------------------------------------------------------------
+
+    [FSM_COMPOSITE_ONESHOT_WAITING] = {
+        [FSM_EVENT_SUPERCTRL_PRESS]         = FSM_ACTION_COMPOSITE_ONESHOT_MOD,
+        [FSM_EVENT_SUPERSHIFT_PRESS]        = FSM_ACTION_COMPOSITE_ONESHOT_MOD,
+        [FSM_EVENT_SUPERALT_PRESS]          = FSM_ACTION_COMPOSITE_ONESHOT_MOD,
+        [FSM_EVENT_SUPERGUI_PRESS]          = FSM_ACTION_COMPOSITE_ONESHOT_MOD,
+        [FSM_EVENT_KEY_PRESS]               = FSM_ACTION_COMPOSITE_ONESHOT_KEY,
+    },
+
+    [FSM_COMPOSITE_ONESHOT_ACTIVE] = {
+        [FSM_EVENT_SUPERCTRL_RELEASE]       = FSM_ACTION_COMPOSITE_ONESHOT_EXIT,
+        [FSM_EVENT_SUPERSHIFT_RELEASE]      = FSM_ACTION_COMPOSITE_ONESHOT_EXIT,
+        [FSM_EVENT_SUPERALT_RELEASE]        = FSM_ACTION_COMPOSITE_ONESHOT_EXIT,
+        [FSM_EVENT_SUPERGUI_RELEASE]        = FSM_ACTION_COMPOSITE_ONESHOT_EXIT,
+        [FSM_EVENT_BITWIG_RELEASE]          = FSM_ACTION_COMPOSITE_ONESHOT_EXIT,
+        [FSM_EVENT_BASE_RELEASE]            = FSM_ACTION_COMPOSITE_ONESHOT_EXIT,
+        [FSM_EVENT_TIMEOUT_RELEASE]         = FSM_ACTION_COMPOSITE_ONESHOT_EXIT,
+        [FSM_EVENT_MOUSE_WATCHER_RELEASE]   = FSM_ACTION_COMPOSITE_ONESHOT_EXIT,
+        [FSM_EVENT_BUTTON_RELEASE]          = FSM_ACTION_COMPOSITE_ONESHOT_EXIT,
+        [FSM_EVENT_WHEEL_RELEASE]           = FSM_ACTION_COMPOSITE_ONESHOT_EXIT,
+        [FSM_EVENT_KEY_RELEASE]             = FSM_ACTION_COMPOSITE_ONESHOT_EXIT,
+        [FSM_EVENT_OTHER_RELEASE]           = FSM_ACTION_COMPOSITE_ONESHOT_EXIT,
+    },
+
+    // ------------------------------------------------------------------------
+    // BASE
+    // ------------------------------------------------------------------------
+
+    [FSM_BASE_AMBIGUOUS] = {
+        [FSM_EVENT_BASE_RELEASE]            = FSM_ACTION_BASE_RELEASE,
+        [FSM_EVENT_TIMEOUT_RELEASE]         = FSM_ACTION_BASE_TIMEOUT,
+        [FSM_EVENT_TIMEOUT_PRESS]           = FSM_ACTION_BASE_TIMEOUT,
+    },
+};
+
+// ============================================================================
+// MODULE API
+// ============================================================================
+
+void keyboard_post_init_eynsai_statemachine(void) {
+    mouse_passthrough_set_buttons_state(MOUSE_PASSTHROUGH_ALL_DEVICES, true, true);
+    mouse_passthrough_set_wheel_state(MOUSE_PASSTHROUGH_ALL_DEVICES, true, true);
+    mouse_passthrough_set_keys_state(MOUSE_PASSTHROUGH_ALL_DEVICES, true, true);
+}
+
+bool process_record_eynsai_statemachine(uint16_t keycode, keyrecord_t *record) {
+
+    // special case for momentary keycodes
+    if (IS_QK_MOMENTARY(keycode)) return true;
+
+    // shouldn't ever need this
+    if (state >= FSM_NODE_COUNT) return true;
+
+    // classify the event and take the pointer button snapshot once, the actions only read these
+    fsm_event_t event = classify_event(keycode, record->event.pressed);
+    bool pointer_buttons_held = pointing_device_get_report().buttons != 0;
+
+    return run_action(fsm_transitions[state][event], keycode, record, pointer_buttons_held);
 }
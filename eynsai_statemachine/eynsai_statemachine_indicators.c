@@ -0,0 +1,35 @@
+// Copyright 2025 Morgan Newell Sun
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "eynsai_statemachine_indicators.h"
+
+// ============================================================================
+// RGB INDICATOR DEFINITIONS
+// ============================================================================
+
+const rgb_indicator_state_t rgb_indicator_states[] = {
+    [INDICATOR_STATE_OFF] = { .breathing = false, .color_a = {0, 0, 0} },
+    [INDICATOR_STATE_BASE] = { .breathing = false, .color_a = COLOR_NEUTRAL },
+    [INDICATOR_STATE_ONESHOT] = { .breathing = true, .color_a = COLOR_ONESHOT_A, .color_b = COLOR_ONESHOT_B, .period_ms = 4000 },
+};
+const rgb_indicator_transition_t rgb_indicator_transitions[] = {
+    [INDICATOR_TRANSITION_TO_CTRL] = { .accent_color = COLOR_CTRL, TIMING_TO },
+    [INDICATOR_TRANSITION_TO_SHIFT] = { .accent_color = COLOR_SHIFT, TIMING_TO },
+    [INDICATOR_TRANSITION_TO_ALT] = { .accent_color = COLOR_ALT, TIMING_TO },
+    [INDICATOR_TRANSITION_TO_GUI] = { .accent_color = COLOR_GUI, TIMING_TO },
+    [INDICATOR_TRANSITION_TO_QWER] = { .accent_color = COLOR_QWER, TIMING_TO },
+    [INDICATOR_TRANSITION_TO_GAME] = { .accent_color = COLOR_GAME, TIMING_TO },
+    [INDICATOR_TRANSITION_FROM_CTRL] = { .accent_color = COLOR_CTRL, TIMING_FROM },
+    [INDICATOR_TRANSITION_FROM_SHIFT] = { .accent_color = COLOR_SHIFT, TIMING_FROM },
+    [INDICATOR_TRANSITION_FROM_ALT] = { .accent_color = COLOR_ALT, TIMING_FROM },
+    [INDICATOR_TRANSITION_FROM_GUI] = { .accent_color = COLOR_GUI, TIMING_FROM },
+    [INDICATOR_TRANSITION_FROM_QWER] = { .accent_color = COLOR_QWER, TIMING_FROM },
+    [INDICATOR_TRANSITION_FROM_GAME] = { .accent_color = COLOR_GAME, TIMING_FROM },
+    [INDICATOR_TRANSITION_FROM_MULTIPLE] = { .accent_color = COLOR_ONESHOT_MIDPOINT, TIMING_FROM },
+    [INDICATOR_TRANSITION_FLASH_NEUTRAL] = { .accent_color = COLOR_NEUTRAL, TIMING_FLASH },
+    [INDICATOR_TRANSITION_FLASH_CTRL] = { .accent_color = COLOR_CTRL, TIMING_FLASH },
+    [INDICATOR_TRANSITION_FLASH_SHIFT] = { .accent_color = COLOR_SHIFT, TIMING_FLASH },
+    [INDICATOR_TRANSITION_FLASH_ALT] = { .accent_color = COLOR_ALT, TIMING_FLASH },
+    [INDICATOR_TRANSITION_FLASH_GUI] = { .accent_color = COLOR_GUI, TIMING_FLASH },
+    [INDICATOR_TRANSITION_FLASH_BITWIG] = { .accent_color = COLOR_BITWIG, TIMING_FLASH },
+};
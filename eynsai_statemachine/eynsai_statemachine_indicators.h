@@ -0,0 +1,42 @@
+// Copyright 2025 Morgan Newell Sun
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Indicator states and transitions for eynsai_statemachine.
+// The tables themselves are defined in eynsai_statemachine_indicators.c (and declared in rgb_indicators.h), so that the
+// host-side timeline tool in rgb_indicators/host can play them back.
+
+#pragma once
+
+#include "rgb_indicators.h"
+
+// ============================================================================
+// RGB INDICATOR DEFINITIONS
+// ============================================================================
+
+typedef enum indicator_state_t {
+    INDICATOR_STATE_OFF = 0,
+    INDICATOR_STATE_BASE,
+    INDICATOR_STATE_ONESHOT,
+} indicator_state_t;
+
+typedef enum indicator_transition_t {
+    INDICATOR_TRANSITION_TO_CTRL = 0,
+    INDICATOR_TRANSITION_TO_SHIFT,
+    INDICATOR_TRANSITION_TO_ALT,
+    INDICATOR_TRANSITION_TO_GUI,
+    INDICATOR_TRANSITION_TO_QWER,
+    INDICATOR_TRANSITION_TO_GAME,
+    INDICATOR_TRANSITION_FROM_CTRL,
+    INDICATOR_TRANSITION_FROM_SHIFT,
+    INDICATOR_TRANSITION_FROM_ALT,
+    INDICATOR_TRANSITION_FROM_GUI,
+    INDICATOR_TRANSITION_FROM_QWER,
+    INDICATOR_TRANSITION_FROM_GAME,
+    INDICATOR_TRANSITION_FROM_MULTIPLE,
+    INDICATOR_TRANSITION_FLASH_NEUTRAL,
+    INDICATOR_TRANSITION_FLASH_CTRL,
+    INDICATOR_TRANSITION_FLASH_SHIFT,
+    INDICATOR_TRANSITION_FLASH_ALT,
+    INDICATOR_TRANSITION_FLASH_GUI,
+    INDICATOR_TRANSITION_FLASH_BITWIG,
+} indicator_transition_t;
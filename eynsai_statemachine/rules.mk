@@ -1 +1,2 @@
-DEFERRED_EXEC_ENABLE = yes
\ No newline at end of file
+DEFERRED_EXEC_ENABLE = yes
+SRC += eynsai_statemachine_indicators.c
@@ -5,6 +5,7 @@
 #include <math.h>
 #include "quantum.h"
 #include "report.h"
+#include "mouse_axis_snapping.h"
 
 ASSERT_COMMUNITY_MODULES_MIN_API_VERSION(1, 1, 0);
 
@@ -12,69 +13,60 @@ ASSERT_COMMUNITY_MODULES_MIN_API_VERSION(1, 1, 0);
 // STATE
 // ============================================================================
 
-typedef enum {
-    MOUSE_AXIS_SNAPPING_UNDECIDED = 0,
-    MOUSE_AXIS_SNAPPING_HORIZONTAL,
-    MOUSE_AXIS_SNAPPING_VERTICAL,
-} mouse_axis_snapping_state_t;
-
 bool mouse_axis_snapping_active = false;
-float mouse_axis_snapping_deviation = 0;
-mouse_axis_snapping_state_t mouse_axis_snapping_state = MOUSE_AXIS_SNAPPING_UNDECIDED;
+mouse_axis_snapping_filter_t mouse_axis_snapping_filter = {0};
 
 // ============================================================================
-// MODULE API
+// FILTER
 // ============================================================================
 
-report_mouse_t pointing_device_task_mouse_axis_snapping(report_mouse_t mouse_report) {
-
-    if (!mouse_axis_snapping_active) return mouse_report;
+report_mouse_t mouse_axis_snapping_apply(mouse_axis_snapping_filter_t *filter, report_mouse_t mouse_report) {
 
-    switch (mouse_axis_snapping_state) {
+    switch (filter->state) {
         case MOUSE_AXIS_SNAPPING_UNDECIDED:
             // we don't know which axis to snap since the user hasn't moved the pointing device
             if (abs(mouse_report.x) > abs(mouse_report.y)) {
                 // snap to horizontal axis
                 mouse_report.y = 0;
-                mouse_axis_snapping_state = MOUSE_AXIS_SNAPPING_HORIZONTAL;
+                filter->state = MOUSE_AXIS_SNAPPING_HORIZONTAL;
             } else if (abs(mouse_report.x) < abs(mouse_report.y)) {
                 // snap to vertical axis
                 mouse_report.x = 0;
-                mouse_axis_snapping_state = MOUSE_AXIS_SNAPPING_VERTICAL;
+                filter->state = MOUSE_AXIS_SNAPPING_VERTICAL;
             }
             break;
         case MOUSE_AXIS_SNAPPING_HORIZONTAL:
-            mouse_axis_snapping_deviation += mouse_report.y;
-            if (mouse_axis_snapping_deviation > 0) {
-                mouse_axis_snapping_deviation -= abs(mouse_report.x) * MOUSE_AXIS_SNAPPING_RATIO;
-                mouse_axis_snapping_deviation = mouse_axis_snapping_deviation < 0 ? 0 : mouse_axis_snapping_deviation;
-            } else if (mouse_axis_snapping_deviation < 0) {
-                mouse_axis_snapping_deviation += abs(mouse_report.x) * MOUSE_AXIS_SNAPPING_RATIO;
-                mouse_axis_snapping_deviation = mouse_axis_snapping_deviation > 0 ? 0 : mouse_axis_snapping_deviation;
+            filter->deviation += mouse_report.y;
+            if (filter->deviation > 0) {
+                filter->deviation -= abs(mouse_report.x) * MOUSE_AXIS_SNAPPING_RATIO;
+                filter->deviation = filter->deviation < 0 ? 0 : filter->deviation;
+            } else if (filter->deviation < 0) {
+                filter->deviation += abs(mouse_report.x) * MOUSE_AXIS_SNAPPING_RATIO;
+                filter->deviation = filter->deviation > 0 ? 0 : filter->deviation;
             }
-            if (fabsf(mouse_axis_snapping_deviation) > MOUSE_AXIS_SNAPPING_THRESHOLD) {
+            if (fabsf(filter->deviation) > MOUSE_AXIS_SNAPPING_THRESHOLD) {
                 // switch to the vertical axis
                 mouse_report.x = 0;
-                mouse_axis_snapping_deviation = 0;
-                mouse_axis_snapping_state = MOUSE_AXIS_SNAPPING_VERTICAL;
+                filter->deviation = 0;
+                filter->state = MOUSE_AXIS_SNAPPING_VERTICAL;
             } else {
                 mouse_report.y = 0;
             }
             break;
         case MOUSE_AXIS_SNAPPING_VERTICAL:
-            mouse_axis_snapping_deviation += mouse_report.x;
-            if (mouse_axis_snapping_deviation > 0) {
-                mouse_axis_snapping_deviation -= abs(mouse_report.y) * MOUSE_AXIS_SNAPPING_RATIO;
-                mouse_axis_snapping_deviation = mouse_axis_snapping_deviation < 0 ? 0 : mouse_axis_snapping_deviation;
-            } else if (mouse_axis_snapping_deviation < 0) {
-                mouse_axis_snapping_deviation += abs(mouse_report.y) * MOUSE_AXIS_SNAPPING_RATIO;
-                mouse_axis_snapping_deviation = mouse_axis_snapping_deviation > 0 ? 0 : mouse_axis_snapping_deviation;
+            filter->deviation += mouse_report.x;
+            if (filter->deviation > 0) {
+                filter->deviation -= abs(mouse_report.y) * MOUSE_AXIS_SNAPPING_RATIO;
+                filter->deviation = filter->deviation < 0 ? 0 : filter->deviation;
+            } else if (filter->deviation < 0) {
+                filter->deviation += abs(mouse_report.y) * MOUSE_AXIS_SNAPPING_RATIO;
+                filter->deviation = filter->deviation > 0 ? 0 : filter->deviation;
             }
-            if (fabsf(mouse_axis_snapping_deviation) > MOUSE_AXIS_SNAPPING_THRESHOLD) {
+            if (fabsf(filter->deviation) > MOUSE_AXIS_SNAPPING_THRESHOLD) {
                 // switch to the horizontal axis
                 mouse_report.y = 0;
-                mouse_axis_snapping_deviation = 0;
-                mouse_axis_snapping_state = MOUSE_AXIS_SNAPPING_HORIZONTAL;
+                filter->deviation = 0;
+                filter->state = MOUSE_AXIS_SNAPPING_HORIZONTAL;
             } else {
                 mouse_report.x = 0;
             }
@@ -84,6 +76,22 @@ report_mouse_t pointing_device_task_mouse_axis_snapping(report_mouse_t mouse_rep
     return mouse_report;
 }
 
+void mouse_axis_snapping_reset(mouse_axis_snapping_filter_t *filter) {
+    filter->deviation = 0;
+    filter->state = MOUSE_AXIS_SNAPPING_UNDECIDED;
+}
+
+// ============================================================================
+// MODULE API
+// ============================================================================
+
+report_mouse_t pointing_device_task_mouse_axis_snapping(report_mouse_t mouse_report) {
+
+    if (!mouse_axis_snapping_active) return mouse_report;
+
+    return mouse_axis_snapping_apply(&mouse_axis_snapping_filter, mouse_report);
+}
+
 // ============================================================================
 // USER API
 // ============================================================================
@@ -91,8 +99,7 @@ report_mouse_t pointing_device_task_mouse_axis_snapping(report_mouse_t mouse_rep
 void mouse_axis_snapping_on(void) {
     if (mouse_axis_snapping_active) return;
     mouse_axis_snapping_active = true;
-    mouse_axis_snapping_deviation = 0;
-    mouse_axis_snapping_state = MOUSE_AXIS_SNAPPING_UNDECIDED;
+    mouse_axis_snapping_reset(&mouse_axis_snapping_filter);
 }
 
 void mouse_axis_snapping_off(void) {
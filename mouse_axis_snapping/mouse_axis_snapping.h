@@ -3,6 +3,22 @@
 
 #pragma once
 
+#include "report.h"
+
+typedef enum {
+    MOUSE_AXIS_SNAPPING_UNDECIDED = 0,
+    MOUSE_AXIS_SNAPPING_HORIZONTAL,
+    MOUSE_AXIS_SNAPPING_VERTICAL,
+} mouse_axis_snapping_state_t;
+
+typedef struct mouse_axis_snapping_filter_t {
+    mouse_axis_snapping_state_t state;
+    float deviation;
+} mouse_axis_snapping_filter_t;
+
 void mouse_axis_snapping_on(void);
 void mouse_axis_snapping_off(void);
 
+// the filter behind mouse_axis_snapping_on, for other modules that snap motion of their own (each keeps its own filter state)
+report_mouse_t mouse_axis_snapping_apply(mouse_axis_snapping_filter_t *filter, report_mouse_t mouse_report);
+void mouse_axis_snapping_reset(mouse_axis_snapping_filter_t *filter);
@@ -0,0 +1,307 @@
+// Copyright 2025 Morgan Newell Sun
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Host-side round-trip test for the mouse_passthrough frame codec.
+//
+// Every frame type is encoded into a report that is filled with junk first, then decoded again and compared with what went in.
+// Since encoders only write the fields of their own frame type, the junk catches fields that an encoder forgets to write, and
+// the bytes after each frame are checked to still hold the junk. Multi-byte fields are also checked against the report_structure_*
+// offsets in mouse_passthrough.h, so that the wire format stays what older devices expect.
+//
+// Build and run (from the repository root):
+//     cc -O2 -Wall -I mouse_passthrough/host -I mouse_passthrough -o mouse_passthrough_codec_test mouse_passthrough/host/mouse_passthrough_codec_test.c
+//     ./mouse_passthrough_codec_test
+
+#include <stdio.h>
+#include "quantum.h"
+
+// the codec only needs the shared protocol constants
+#define MOUSE_PASSTHROUGH_RECEIVER
+#include "../post_config.h"
+#undef MOUSE_PASSTHROUGH_RECEIVER
+
+#include "mouse_passthrough_codec.h"
+
+#define JUNK 0xA5
+
+static uint32_t checks = 0;
+static uint32_t failures = 0;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        checks++;                                                               \
+        if (!(condition)) {                                                     \
+            failures++;                                                         \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        }                                                                       \
+    } while (0)
+
+static uint8_t report[QMK_RAW_HID_REPORT_SIZE];
+
+static void fill_junk(void) {
+    memset(report, JUNK, sizeof(report));
+}
+
+// the bytes from offset to the end of the report must not have been written
+static bool untouched_from(uint8_t offset) {
+    for (uint8_t i = offset; i < sizeof(report); i++) {
+        if (report[i] != JUNK) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// TESTS
+// ============================================================================
+
+static void test_header(void) {
+    fill_junk();
+    encode_header(report, 7);
+    CHECK(report[REPORT_OFFSET_COMMAND_ID] == RAW_HID_HUB_COMMAND_ID);
+    CHECK(report[REPORT_OFFSET_DEVICE_ID] == 7);
+    CHECK(frame_command_id(report) == RAW_HID_HUB_COMMAND_ID);
+    CHECK(frame_device_id(report) == 7);
+    set_frame_device_id(report, 9);
+    CHECK(frame_device_id(report) == 9);
+    CHECK(untouched_from(sizeof(frame_header_t)));
+}
+
+static void test_registration(void) {
+    fill_junk();
+    encode_header(report, DEVICE_ID_HUB);
+    CHECK(!decode_registration(report));
+    encode_registration(report);
+    CHECK(report[REPORT_OFFSET_REGISTRATION] == 0x01);
+    CHECK(decode_registration(report));
+    CHECK(untouched_from(sizeof(registration_frame_t)));
+}
+
+static void test_device_list(void) {
+    uint8_t others[MAX_REGISTERED_DEVICES - 1];
+    for (uint8_t i = 0; i < sizeof(others); i++) {
+        others[i] = (i % 3 == 0) ? DEVICE_ID_UNASSIGNED : i;
+    }
+    fill_junk();
+    encode_header(report, DEVICE_ID_HUB);
+    encode_device_list(report, 4, others);
+    CHECK(report[REPORT_OFFSET_DEVICE_ID_SELF] == 4);
+    CHECK(report[REPORT_OFFSET_DEVICE_ID_OTHERS + 1] == 1);
+    uint8_t device_id_self = 0;
+    const uint8_t *decoded = decode_device_list(report, &device_id_self);
+    CHECK(device_id_self == 4);
+    CHECK(memcmp(decoded, others, sizeof(others)) == 0);
+    CHECK(untouched_from(sizeof(device_list_frame_t)));
+}
+
+static void test_handshake(void) {
+    handshake_t handshake = {.step = 39, .version = MOUSE_PASSTHROUGH_PROTOCOL_VERSION, .report_size = 64, .frame_formats = CAPABILITY_FRAME_LEGACY | CAPABILITY_FRAME_PACKED, .features = CAPABILITY_FEATURE_KEYS};
+    fill_junk();
+    encode_handshake(report, &handshake);
+    CHECK(report[REPORT_OFFSET_HANDSHAKE] == 39);
+    CHECK(report[REPORT_OFFSET_CAPABILITY_REPORT_SIZE] == 64);
+    CHECK(handshake_step(report) == 39);
+    handshake_t decoded;
+    decode_handshake(report, &decoded);
+    CHECK(decoded.step == handshake.step);
+    CHECK(decoded.version == handshake.version);
+    CHECK(decoded.report_size == handshake.report_size);
+    CHECK(decoded.frame_formats == handshake.frame_formats);
+    CHECK(decoded.features == handshake.features);
+    CHECK(untouched_from(sizeof(handshake_frame_t)));
+}
+
+static void test_ping(void) {
+    fill_junk();
+    encode_ping(report);
+    stamp_ping(report, 0x1234);
+    CHECK(frame_type(report) == REPORT_FRAME_PING);
+    CHECK(report[REPORT_OFFSET_PING_TIME_MSB] == 0x12 && report[REPORT_OFFSET_PING_TIME_LSB] == 0x34);
+    CHECK(decode_ping(report) == 0x1234);
+    CHECK(untouched_from(REPORT_OFFSET_PONG_MESSAGES_SENT_MSB));
+}
+
+static void test_pong(void) {
+    mouse_passthrough_stats_t counters = {.messages_sent = 0x12345678, .messages_received = 0xFFFF, .queue_full = 3, .coalesced = 0x10000, .max_queue_depth = 9};
+    fill_junk();
+    encode_pong(report, 0xBEEF, &counters);
+    CHECK(frame_type(report) == REPORT_FRAME_PONG);
+    CHECK(report[REPORT_OFFSET_PONG_MESSAGES_SENT_MSB] == 0x56 && report[REPORT_OFFSET_PONG_MESSAGES_SENT_LSB] == 0x78);
+    mouse_passthrough_stats_t decoded = {0};
+    CHECK(decode_pong(report, &decoded) == 0xBEEF);
+    CHECK(decoded.remote_messages_sent == 0x5678);
+    CHECK(decoded.remote_messages_received == 0xFFFF);
+    CHECK(decoded.remote_queue_full == 3);
+    CHECK(decoded.remote_coalesced == 0);
+    CHECK(decoded.remote_max_queue_depth == 9);
+    CHECK(untouched_from(sizeof(ping_frame_t)));
+}
+
+static void test_control_payload(void) {
+    control_frame_t control = {
+        .sequence = 200,
+        .block_buttons = true,
+        .block_pointer = false,
+        .block_wheel = true,
+        .send_buttons = false,
+        .send_pointer = true,
+        .send_wheel = false,
+        .reset = true,
+        .block_keys = false,
+        .send_keys = true,
+        .credit = 17,
+        .pointer_filter = MOUSE_PASSTHROUGH_POINTER_FILTER_DRAGSCROLL,
+        .pointer_interval = 16,
+    };
+    fill_junk();
+    encode_control_payload(report, &control);
+    CHECK(frame_type(report) == REPORT_FRAME_LEGACY);
+    CHECK(report[REPORT_OFFSET_CONTROL_SEQUENCE] == 200);
+    CHECK(report[REPORT_OFFSET_RESET] == 1);
+    control_frame_t decoded;
+    decode_control_payload(report, &decoded);
+    CHECK(memcmp(&decoded, &control, sizeof(control)) == 0);
+    // the data payload of the legacy layout is left alone
+    CHECK(report[REPORT_OFFSET_DATA_BUTTONS] == JUNK && report[REPORT_OFFSET_DATA_H_LSB] == JUNK);
+    CHECK(untouched_from(sizeof(legacy_frame_t)));
+}
+
+static void test_control_ack(void) {
+    control_frame_t ack = {.sequence = 1, .block_buttons = false, .block_pointer = true, .send_buttons = true, .send_wheel = true, .block_keys = true};
+    fill_junk();
+    encode_control_ack(report, &ack);
+    CHECK(frame_type(report) == REPORT_FRAME_CONTROL_ACK);
+    CHECK(report[REPORT_OFFSET_CONTROL_ACK_BLOCK_POINTER] == 1);
+    control_frame_t decoded = {0};
+    decode_control_ack(report, &decoded);
+    CHECK(memcmp(&decoded, &ack, sizeof(ack)) == 0);
+    CHECK(untouched_from(sizeof(control_ack_frame_t)));
+}
+
+static void test_legacy_sample(void) {
+    packed_sample_t sample = {.buttons = 0x05, .x = -300, .y = 1, .v = -1, .h = INT16_MAX};
+    fill_junk();
+    encode_legacy_sample(report, &sample);
+    CHECK(frame_type(report) == REPORT_FRAME_LEGACY);
+    CHECK(report[REPORT_OFFSET_DATA_X_MSB] == 0xFE && report[REPORT_OFFSET_DATA_X_LSB] == 0xD4);
+    packed_sample_t decoded;
+    decode_legacy_sample(report, &decoded);
+    CHECK(decoded.flags == PACKED_SAMPLE_BUTTONS);
+    CHECK(decoded.dt == 0);
+    CHECK(decoded.buttons == sample.buttons);
+    CHECK(decoded.x == sample.x && decoded.y == sample.y && decoded.v == sample.v && decoded.h == sample.h);
+    // the control payload of the legacy layout is left alone
+    CHECK(report[REPORT_OFFSET_CONTROL_BLOCK_BUTTONS] == JUNK);
+    CHECK(untouched_from(REPORT_OFFSET_CONTROL_BLOCK_BUTTONS));
+}
+
+static void test_packed_frame(void) {
+    const packed_sample_t samples[] = {
+        {.dt = 0, .x = 1, .y = -1},
+        {.dt = 2, .flags = PACKED_SAMPLE_BUTTONS, .buttons = 0x01},
+        {.dt = 3, .x = 127, .y = -128, .v = 1},
+        {.dt = 200, .x = 128, .y = -129, .v = -300, .h = 2},
+        {.dt = 1, .flags = PACKED_SAMPLE_BUTTONS, .buttons = 0x00, .v = 5, .h = -5},
+    };
+    const uint8_t count = sizeof(samples) / sizeof(samples[0]);
+    fill_junk();
+    encode_header(report, 3);
+    encode_packed_frame(report, 0xFFFE);
+    packed_frame_t *frame = (packed_frame_t *)report;
+    uint8_t offset = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t encoded[PACKED_SAMPLE_MAX_LENGTH];
+        uint8_t length = encode_packed_sample(encoded, &samples[i]);
+        CHECK(length == packed_sample_length(encoded[0]));
+        CHECK(sizeof(packed_frame_t) + offset + length <= sizeof(report));
+        memcpy(frame->samples + offset, encoded, length);
+        frame->count++;
+        offset += length;
+    }
+    CHECK(frame_type(report) == REPORT_FRAME_PACKED);
+    CHECK(report[REPORT_OFFSET_PACKED_COUNT] == count);
+    CHECK(report[REPORT_OFFSET_PACKED_TIME_MSB] == 0xFF && report[REPORT_OFFSET_PACKED_TIME_LSB] == 0xFE);
+    CHECK(read_uint16(&frame->time) == 0xFFFE);
+    uint8_t decoded_offset = 0;
+    for (uint8_t i = 0; i < frame->count; i++) {
+        packed_sample_t decoded;
+        decoded_offset = decode_packed_sample(frame->samples, decoded_offset, &decoded);
+        CHECK(decoded.dt == samples[i].dt);
+        CHECK((decoded.flags & PACKED_SAMPLE_BUTTONS) == (samples[i].flags & PACKED_SAMPLE_BUTTONS));
+        CHECK(!(decoded.flags & PACKED_SAMPLE_BUTTONS) || decoded.buttons == samples[i].buttons);
+        CHECK(decoded.x == samples[i].x && decoded.y == samples[i].y && decoded.v == samples[i].v && decoded.h == samples[i].h);
+    }
+    CHECK(decoded_offset == offset);
+    CHECK(untouched_from(sizeof(packed_frame_t) + offset));
+}
+
+static void test_key_frame(void) {
+    uint16_t held_keys[MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS] = {KC_NO};
+    const key_event_t events[] = {
+        {.time = 0x0102, .keycode = 0x0004, .pressed = true},
+        {.time = 0x0103, .keycode = 0x7C00, .pressed = true},
+        {.time = 0x0110, .keycode = 0x0004, .pressed = false},
+    };
+    fill_junk();
+    encode_key_frame(report);
+    CHECK(frame_type(report) == REPORT_FRAME_KEY);
+    CHECK(key_frame_length(report) == REPORT_OFFSET_KEY_EVENTS);
+
+    // the first two events fit in a legacy size report next to a full set of held keys, the third one doesn't
+    held_keys[0] = 0x0004;
+    CHECK(encode_key_event(report, MOUSE_PASSTHROUGH_LEGACY_REPORT_SIZE, &events[0], held_keys));
+    held_keys[1] = 0x7C00;
+    CHECK(encode_key_event(report, MOUSE_PASSTHROUGH_LEGACY_REPORT_SIZE, &events[1], held_keys));
+    held_keys[0] = KC_NO;
+    bool fits = REPORT_OFFSET_KEY_EVENTS + 3 * KEY_EVENT_LENGTH + MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS * 2 <= MOUSE_PASSTHROUGH_LEGACY_REPORT_SIZE;
+    CHECK(encode_key_event(report, MOUSE_PASSTHROUGH_LEGACY_REPORT_SIZE, &events[2], held_keys) == fits);
+    uint8_t count = fits ? 3 : 2;
+    if (!fits) {
+        // a refresh carries the held keys after the events that are already in the frame
+        encode_held_keys(report, held_keys);
+    }
+
+    CHECK(report[REPORT_OFFSET_KEY_COUNT] == count);
+    CHECK(report[REPORT_OFFSET_KEY_HELD_COUNT] == 1);
+    CHECK(report[REPORT_OFFSET_KEY_EVENTS + KEY_EVENT_LENGTH + KEY_EVENT_OFFSET_KEYCODE_MSB] == 0x7C);
+    CHECK(key_frame_length(report) == REPORT_OFFSET_KEY_EVENTS + count * KEY_EVENT_LENGTH + 2);
+    for (uint8_t i = 0; i < count; i++) {
+        key_event_t decoded;
+        decode_key_event(report, i, &decoded);
+        CHECK(decoded.time == events[i].time && decoded.keycode == events[i].keycode && decoded.pressed == events[i].pressed);
+    }
+    CHECK(decode_held_key(report, 0) == 0x7C00);
+    CHECK(key_frame_holds(report, 0x7C00));
+    CHECK(!key_frame_holds(report, 0x0004));
+    CHECK(untouched_from(key_frame_length(report)));
+}
+
+// counts that no report can hold must give a length past the report, not one that wraps around and looks valid
+static void test_key_frame_oversized(void) {
+    const uint8_t counts[][2] = {{51, 0}, {0, 255}, {255, 3}, {255, 255}};
+    for (uint8_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        fill_junk();
+        encode_key_frame(report);
+        report[REPORT_OFFSET_KEY_COUNT] = counts[i][0];
+        report[REPORT_OFFSET_KEY_HELD_COUNT] = counts[i][1];
+        CHECK(key_frame_length(report) > QMK_RAW_HID_REPORT_SIZE);
+    }
+}
+
+int main(void) {
+    test_header();
+    test_registration();
+    test_device_list();
+    test_handshake();
+    test_ping();
+    test_pong();
+    test_control_payload();
+    test_control_ack();
+    test_legacy_sample();
+    test_packed_frame();
+    test_key_frame();
+    test_key_frame_oversized();
+    printf("%u checks, %u failed\n", checks, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,658 @@
+// Copyright 2025 Morgan Newell Sun
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Host-side hub simulator for mouse_passthrough.
+//
+// Runs the receiver and one or two sender builds of mouse_passthrough.c in one process on a virtual clock, connected
+// through a stand-in for raw-hid-hub that implements registration, the device list broadcast, routing and
+// shutdown. Links have configurable latency, jitter and loss, and extra dummy devices can be registered
+// to fill the hub up to MAX_REGISTERED_DEVICES. Prints handshake time, throughput and loss.
+//
+// Build (from the repository root):
+//     cc -O2 -I mouse_passthrough/host -I mouse_passthrough -o mouse_passthrough_sim mouse_passthrough/host/mouse_passthrough_sim*.c
+// Module defines (e.g. -DMOUSE_PASSTHROUGH_PLAYOUT_DELAY_MS=0) can be added to the same command line.
+// With -DMOUSE_PASSTHROUGH_TRANSPORT_LOOPBACK, the receiver and one sender are linked directly instead of through the hub.
+
+#include <stdio.h>
+#include "quantum.h"
+#include "mouse_passthrough_sim.h"
+
+// the hub only needs the shared protocol constants
+#define MOUSE_PASSTHROUGH_RECEIVER
+#include "../post_config.h"
+#undef MOUSE_PASSTHROUGH_RECEIVER
+
+// ============================================================================
+// SETTINGS
+// ============================================================================
+
+static uint32_t duration_ms = 20000;
+static uint32_t latency_ms = 2;
+static uint32_t jitter_ms = 2;
+static uint32_t loss_permille = 0;
+static uint32_t device_count = 2;
+static uint32_t sender_count = 1;
+static uint32_t sample_interval_ms = 1;
+static uint32_t housekeeping_interval_ms = 1;
+static uint32_t hub_restart_ms = 0;
+static uint32_t control_toggle_ms = 0;
+static uint32_t pointer_filter = MOUSE_PASSTHROUGH_POINTER_FILTER_NONE;
+static uint32_t key_interval_ms = 0;
+static uint32_t report_interval_ms = 1;
+static int32_t receiver_clock_offset = 12345;
+static uint32_t seed = 1;
+
+// ============================================================================
+// VIRTUAL CLOCK
+// ============================================================================
+
+static uint32_t virtual_time = 0;
+
+#define SIM_DEFINE_CLOCK(role, offset)                                      \
+    uint32_t SIM_CONCAT(role, timer_read32)(void) {                         \
+        return virtual_time + (offset);                                     \
+    }                                                                       \
+    uint32_t SIM_CONCAT(role, timer_elapsed32)(uint32_t last) {             \
+        return SIM_CONCAT(role, timer_read32)() - last;                     \
+    }                                                                       \
+    uint16_t SIM_CONCAT(role, timer_read)(void) {                           \
+        return (uint16_t)SIM_CONCAT(role, timer_read32)();                  \
+    }                                                                       \
+    uint16_t SIM_CONCAT(role, timer_elapsed)(uint16_t last) {               \
+        return (uint16_t)(SIM_CONCAT(role, timer_read)() - last);           \
+    }
+
+SIM_DEFINE_CLOCK(sender, 0)
+SIM_DEFINE_CLOCK(sender2, 777)
+SIM_DEFINE_CLOCK(receiver, receiver_clock_offset)
+
+static uint32_t random_state;
+
+static uint32_t random_next(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+// ============================================================================
+// HUB
+// ============================================================================
+
+// device 0 is the receiver, devices 1 to sender_count are senders, the rest are dummies that register and ignore everything
+#define SIM_DEVICE_RECEIVER 0
+#ifdef MOUSE_PASSTHROUGH_TRANSPORT_LOOPBACK
+#    define SIM_MAX_SENDERS 1
+#    define SIM_RECEIVE(role) SIM_CONCAT(role, mouse_passthrough_loopback_receive)
+#else
+#    define SIM_MAX_SENDERS 2
+#    define SIM_RECEIVE(role) SIM_CONCAT(role, raw_hid_receive)
+#endif
+
+typedef struct sim_sender_t {
+    const char *name;
+    void (*post_init)(void);
+    void (*housekeeping)(void);
+    void (*receive)(uint8_t *data, uint8_t length);
+    bool (*is_connected)(void);
+    report_mouse_t (*pointing_device_task)(report_mouse_t mouse);
+    void (*get_stats)(mouse_passthrough_stats_t *stats);
+    uint8_t button;
+    uint32_t hid_sends_this_tick;
+} sim_sender_t;
+
+static sim_sender_t senders[2] = {
+    {"sender", sender_keyboard_post_init_mouse_passthrough, sender_housekeeping_task_mouse_passthrough, SIM_RECEIVE(sender), sender_is_mouse_passthrough_connected, sender_pointing_device_task_mouse_passthrough, sender_mouse_passthrough_get_stats, 1 << 0, 0},
+    {"sender2", sender2_keyboard_post_init_mouse_passthrough, sender2_housekeeping_task_mouse_passthrough, SIM_RECEIVE(sender2), sender2_is_mouse_passthrough_connected, sender2_pointing_device_task_mouse_passthrough, sender2_mouse_passthrough_get_stats, 1 << 1, 0},
+};
+
+#define MAX_IN_FLIGHT 8192
+
+typedef struct in_flight_t {
+    uint32_t deliver_time;
+    uint8_t device;
+    uint8_t data[QMK_RAW_HID_REPORT_SIZE];
+} in_flight_t;
+
+static in_flight_t in_flight[MAX_IN_FLIGHT];
+static uint32_t in_flight_count = 0;
+static uint32_t last_deliver_time[MAX_REGISTERED_DEVICES];
+static uint8_t hub_ids[MAX_REGISTERED_DEVICES];
+static uint8_t next_hub_id = 0;
+
+static uint32_t messages_routed = 0;
+static uint32_t messages_lost = 0;
+static uint32_t status_broadcasts = 0;
+static uint32_t data_frames = 0;
+static uint32_t data_samples = 0;
+
+static void deliver_later(uint8_t device, const uint8_t *data) {
+    if (loss_permille > 0 && random_next() % 1000 < loss_permille) {
+        messages_lost++;
+        return;
+    }
+    if (in_flight_count == MAX_IN_FLIGHT) {
+        fprintf(stderr, "too many messages in flight\n");
+        exit(1);
+    }
+    // the hub delivers to each device in order, jitter only stretches the gaps
+    uint32_t deliver_time = virtual_time + latency_ms + (jitter_ms > 0 ? random_next() % (jitter_ms + 1) : 0);
+    if (deliver_time < last_deliver_time[device]) {
+        deliver_time = last_deliver_time[device];
+    }
+    last_deliver_time[device] = deliver_time;
+    in_flight_t *message = &in_flight[in_flight_count++];
+    message->deliver_time = deliver_time;
+    message->device = device;
+    memcpy(message->data, data, QMK_RAW_HID_REPORT_SIZE);
+}
+
+static int device_for_hub_id(uint8_t hub_id) {
+    for (uint32_t i = 0; i < device_count; i++) {
+        if (hub_ids[i] == hub_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void hub_broadcast_status(void) {
+    status_broadcasts++;
+    for (uint32_t i = 0; i < device_count; i++) {
+        if (hub_ids[i] == DEVICE_ID_UNASSIGNED) {
+            continue;
+        }
+        uint8_t status[QMK_RAW_HID_REPORT_SIZE];
+        memset(status, DEVICE_ID_UNASSIGNED, sizeof(status));
+        status[REPORT_OFFSET_COMMAND_ID] = RAW_HID_HUB_COMMAND_ID;
+        status[REPORT_OFFSET_DEVICE_ID] = DEVICE_ID_HUB;
+        status[REPORT_OFFSET_DEVICE_ID_SELF] = hub_ids[i];
+        uint8_t offset = REPORT_OFFSET_DEVICE_ID_OTHERS;
+        for (uint32_t j = 0; j < device_count; j++) {
+            if (j != i && hub_ids[j] != DEVICE_ID_UNASSIGNED && offset < QMK_RAW_HID_REPORT_SIZE) {
+                status[offset++] = hub_ids[j];
+            }
+        }
+        deliver_later(i, status);
+    }
+}
+
+static void hub_receive(uint8_t device, const uint8_t *data) {
+    if (data[REPORT_OFFSET_COMMAND_ID] != RAW_HID_HUB_COMMAND_ID) {
+        return;
+    }
+    if (data[REPORT_OFFSET_DEVICE_ID] == DEVICE_ID_HUB) {
+        if (data[REPORT_OFFSET_REGISTRATION] == 0x01) {
+            if (hub_ids[device] == DEVICE_ID_UNASSIGNED) {
+                if (next_hub_id >= MAX_REGISTERED_DEVICES) {
+                    return;
+                }
+                hub_ids[device] = next_hub_id++;
+            }
+            hub_broadcast_status();
+        }
+        return;
+    }
+    int destination = device_for_hub_id(data[REPORT_OFFSET_DEVICE_ID]);
+    if (hub_ids[device] == DEVICE_ID_UNASSIGNED || destination < 0) {
+        return;
+    }
+    uint8_t routed[QMK_RAW_HID_REPORT_SIZE];
+    memcpy(routed, data, sizeof(routed));
+    routed[REPORT_OFFSET_DEVICE_ID] = hub_ids[device];
+    messages_routed++;
+    if (device != SIM_DEVICE_RECEIVER && data[REPORT_OFFSET_FRAME_TYPE] == REPORT_FRAME_PACKED) {
+        data_frames++;
+        data_samples += data[REPORT_OFFSET_PACKED_COUNT];
+    }
+    deliver_later(destination, routed);
+}
+
+static void hub_shutdown(void) {
+    uint8_t shutdown[QMK_RAW_HID_REPORT_SIZE] = {0};
+    shutdown[REPORT_OFFSET_COMMAND_ID] = RAW_HID_HUB_COMMAND_ID;
+    shutdown[REPORT_OFFSET_DEVICE_ID] = DEVICE_ID_HUB;
+    shutdown[REPORT_OFFSET_DEVICE_ID_SELF] = DEVICE_ID_UNASSIGNED;
+    for (uint32_t i = 0; i < device_count; i++) {
+        if (hub_ids[i] != DEVICE_ID_UNASSIGNED) {
+            deliver_later(i, shutdown);
+        }
+        hub_ids[i] = DEVICE_ID_UNASSIGNED;
+    }
+    next_hub_id = 0;
+}
+
+// without the hub, each message goes straight to the other device
+static void link_send(uint8_t device, const uint8_t *data) {
+#ifdef MOUSE_PASSTHROUGH_TRANSPORT_LOOPBACK
+    messages_routed++;
+    if (device != SIM_DEVICE_RECEIVER && data[REPORT_OFFSET_FRAME_TYPE] == REPORT_FRAME_PACKED) {
+        data_frames++;
+        data_samples += data[REPORT_OFFSET_PACKED_COUNT];
+    }
+    deliver_later(device == SIM_DEVICE_RECEIVER ? 1 : SIM_DEVICE_RECEIVER, data);
+#else
+    hub_receive(device, data);
+#endif
+}
+
+static void deliver_due_messages(void) {
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < in_flight_count; i++) {
+        in_flight_t *message = &in_flight[i];
+        if (message->deliver_time > virtual_time) {
+            in_flight[kept++] = *message;
+            continue;
+        }
+        if (message->device == SIM_DEVICE_RECEIVER) {
+            SIM_RECEIVE(receiver)(message->data, QMK_RAW_HID_REPORT_SIZE);
+        } else if (message->device <= sender_count) {
+            senders[message->device - 1].receive(message->data, QMK_RAW_HID_REPORT_SIZE);
+        }
+    }
+    in_flight_count = kept;
+}
+
+// ============================================================================
+// DEVICE STUBS
+// ============================================================================
+
+static uint32_t receiver_hid_sends_this_tick = 0;
+static uint32_t extra_hid_sends = 0;
+
+static void sender_send(uint8_t index, uint8_t *data) {
+    if (senders[index].hid_sends_this_tick++ > 0) {
+        extra_hid_sends++;
+    }
+    link_send(index + 1, data);
+}
+
+void sender_raw_hid_send(uint8_t *data, uint8_t length) {
+    (void)length;
+    sender_send(0, data);
+}
+
+void sender2_raw_hid_send(uint8_t *data, uint8_t length) {
+    (void)length;
+    sender_send(1, data);
+}
+
+void receiver_raw_hid_send(uint8_t *data, uint8_t length) {
+    (void)length;
+    if (receiver_hid_sends_this_tick++ > 0) {
+        extra_hid_sends++;
+    }
+    link_send(SIM_DEVICE_RECEIVER, data);
+}
+
+void sender_mouse_passthrough_loopback_send(uint8_t *data, uint8_t length) {
+    sender_raw_hid_send(data, length);
+}
+
+void sender2_mouse_passthrough_loopback_send(uint8_t *data, uint8_t length) {
+    sender2_raw_hid_send(data, length);
+}
+
+void receiver_mouse_passthrough_loopback_send(uint8_t *data, uint8_t length) {
+    receiver_raw_hid_send(data, length);
+}
+
+void sender_reset_keyboard(void) {
+    printf("sender: reset_keyboard\n");
+}
+
+void sender2_reset_keyboard(void) {
+    printf("sender2: reset_keyboard\n");
+}
+
+void receiver_reset_keyboard(void) {
+    printf("receiver: reset_keyboard\n");
+}
+
+// forwarded keys are checked against the order the first sender pressed them in, and their timestamps against the sender's clock
+typedef struct sim_key_event_t {
+    uint16_t event;  // keycode, with the top bit set for releases
+    uint32_t time;
+} sim_key_event_t;
+
+static sim_key_event_t keys_expected[64];
+static uint32_t keys_expected_head = 0, keys_expected_count = 0;
+static uint32_t key_events_received = 0, key_events_missed = 0, key_events_caught_up = 0, keys_registered = 0;
+static int32_t keys_down = 0;
+static int64_t key_time_error_total = 0;
+
+static void expect_key_event(uint16_t keycode, bool pressed) {
+    sim_key_event_t *expected = &keys_expected[(keys_expected_head + keys_expected_count++) % 64];
+    expected->event = pressed ? keycode : (keycode | 0x8000);
+    expected->time = virtual_time;
+}
+
+static void receive_key_event(uint16_t keycode, keyrecord_t *record) {
+    if (record->event.type != KEY_EVENT) {
+        return;
+    }
+    uint16_t event = record->event.pressed ? keycode : (keycode | 0x8000);
+    key_events_received++;
+    keys_down += record->event.pressed ? 1 : -1;
+    // events from lost frames are skipped, and events that aren't expected at all come from the held keys catching up
+    uint32_t skipped = 0;
+    while (skipped < keys_expected_count && keys_expected[(keys_expected_head + skipped) % 64].event != event) {
+        skipped++;
+    }
+    if (skipped == keys_expected_count) {
+        key_events_caught_up++;
+        return;
+    }
+    key_events_missed += skipped;
+    keys_expected_head = (keys_expected_head + skipped) % 64;
+    keys_expected_count -= skipped;
+    // how much later than the real press or release the event time is, on the receiver's clock
+    key_time_error_total += (int16_t)(uint16_t)(record->event.time - (uint16_t)(keys_expected[keys_expected_head].time + receiver_clock_offset));
+    keys_expected_head = (keys_expected_head + 1) % 64;
+    keys_expected_count--;
+}
+
+#if defined(COMBO_ENABLE) || defined(REPEAT_KEY_ENABLE)
+// stands in for QMK's process_record, which registers the keycode when nothing in the keymap handles it
+void receiver_process_record(keyrecord_t *record) {
+    receive_key_event(record->keycode, record);
+    keys_registered += record->event.pressed ? 1 : 0;
+}
+#else
+bool receiver_process_record_modules(uint16_t keycode, keyrecord_t *record) {
+    receive_key_event(keycode, record);
+    return true;
+}
+
+bool receiver_process_record_kb(uint16_t keycode, keyrecord_t *record) {
+    return true;
+}
+
+void receiver_register_code16(uint16_t keycode) {
+    keys_registered++;
+}
+
+void receiver_unregister_code16(uint16_t keycode) {}
+#endif
+
+// ============================================================================
+// RECEIVER REPORTS
+// ============================================================================
+
+// the receiver's pointing device task is called on every scan before raw hid messages are received, like in QMK's main loop,
+// and is throttled to one run per report interval like with POINTING_DEVICE_TASK_THROTTLE_MS (0 for none), whoever calls it
+static int64_t *motion_sent_history = NULL;  // total motion sent by each ms
+static int64_t motion_received = 0;
+static uint32_t edges_received = 0;
+static uint8_t received_buttons = 0;
+static uint32_t pointing_device_tasks = 0, pointing_device_tasks_by_module = 0;
+static uint32_t last_pointing_device_task_time = 0;
+// motion delay is how long ago the sent total reached what has been received so far
+static uint32_t motion_delay_cursor = 0, motion_delay_samples = 0, motion_delay_max = 0;
+static uint64_t motion_delay_total = 0;
+
+bool receiver_pointing_device_task(void) {
+    if (report_interval_ms > 0 && pointing_device_tasks > 0 && virtual_time - last_pointing_device_task_time < report_interval_ms) {
+        return false;
+    }
+    last_pointing_device_task_time = virtual_time;
+    pointing_device_tasks++;
+    report_mouse_t received = receiver_pointing_device_driver_get_report((report_mouse_t){0});
+    motion_received += received.x - received.y;
+    if (received.x != 0 || received.y != 0) {
+        while (motion_sent_history[motion_delay_cursor] < motion_received && motion_delay_cursor < virtual_time) {
+            motion_delay_cursor++;
+        }
+        uint32_t delay = virtual_time - motion_delay_cursor;
+        motion_delay_total += delay;
+        motion_delay_samples++;
+        if (delay > motion_delay_max) {
+            motion_delay_max = delay;
+        }
+    }
+    for (uint8_t changed = received.buttons ^ received_buttons; changed != 0; changed &= changed - 1) {
+        edges_received++;
+    }
+    bool changed = received.x != 0 || received.y != 0 || received.buttons != received_buttons;
+    received_buttons = received.buttons;
+    return changed;
+}
+
+static void register_dummies(void) {
+    uint8_t registration[QMK_RAW_HID_REPORT_SIZE] = {0};
+    registration[REPORT_OFFSET_COMMAND_ID] = RAW_HID_HUB_COMMAND_ID;
+    registration[REPORT_OFFSET_DEVICE_ID] = DEVICE_ID_HUB;
+    registration[REPORT_OFFSET_REGISTRATION] = 0x01;
+    for (uint32_t i = sender_count + 1; i < device_count; i++) {
+        hub_receive(i, registration);
+    }
+}
+
+// ============================================================================
+// SIMULATION
+// ============================================================================
+
+static void print_stats(const char *role, const mouse_passthrough_stats_t *stats) {
+    printf("%s: sent %lu, received %lu, queue full %lu, coalesced %lu, max depth %u, handshake messages %u, connections %u, control retransmits %u, max send interval %u ms, ingress overflows %u\n", role, (unsigned long)stats->messages_sent, (unsigned long)stats->messages_received, (unsigned long)stats->queue_full, (unsigned long)stats->coalesced, stats->max_queue_depth, stats->handshake_messages_sent, stats->connections, stats->control_retransmits, stats->max_send_interval_ms, stats->ingress_overflows);
+    printf("%s: pings %u, pongs %u, rtt p50 %u ms, p99 %u ms\n", role, stats->pings_sent, stats->pongs_received, stats->rtt_p50_ms, stats->rtt_p99_ms);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-d duration_ms] [-l latency_ms] [-j jitter_ms] [-p loss_permille] [-n devices] [-m senders] [-i sample_interval_ms] [-t housekeeping_interval_ms] [-x hub_restart_ms] [-c control_toggle_ms] [-f pointer_filter] [-k key_interval_ms] [-r report_interval_ms] [-o receiver_clock_offset] [-s seed]\n", name);
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-' || argv[i][1] == '\0' || argv[i][2] != '\0' || i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        long value = strtol(argv[++i], NULL, 10);
+        switch (argv[i - 1][1]) {
+            case 'd': duration_ms = value; break;
+            case 'l': latency_ms = value; break;
+            case 'j': jitter_ms = value; break;
+            case 'p': loss_permille = value; break;
+            case 'n': device_count = value; break;
+            case 'm': sender_count = value; break;
+            case 'i': sample_interval_ms = value; break;
+            case 't': housekeeping_interval_ms = value; break;
+            case 'x': hub_restart_ms = value; break;
+            case 'c': control_toggle_ms = value; break;
+            case 'f': pointer_filter = value; break;
+            case 'k': key_interval_ms = value; break;
+            case 'r': report_interval_ms = value; break;
+            case 'o': receiver_clock_offset = value; break;
+            case 's': seed = value; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (sender_count < 1 || sender_count > SIM_MAX_SENDERS || device_count < sender_count + 1 || device_count > MAX_REGISTERED_DEVICES || sample_interval_ms == 0 || housekeeping_interval_ms == 0) {
+        fprintf(stderr, "need 1 to %d senders, up to %d devices including them and the receiver, and nonzero intervals\n", SIM_MAX_SENDERS, MAX_REGISTERED_DEVICES);
+        return 2;
+    }
+#ifdef MOUSE_PASSTHROUGH_TRANSPORT_LOOPBACK
+    if (device_count != 2 || hub_restart_ms > 0) {
+        fprintf(stderr, "the loopback transport has no hub, so there are no dummy devices or hub restarts\n");
+        return 2;
+    }
+#endif
+    random_state = seed ? seed : 1;
+    memset(hub_ids, DEVICE_ID_UNASSIGNED, sizeof(hub_ids));
+    register_dummies();
+    receiver_keyboard_post_init_mouse_passthrough();
+    for (uint32_t i = 0; i < sender_count; i++) {
+        senders[i].post_init();
+    }
+
+    // motion is only generated inside the measurement window, so that totals can be compared exactly
+    const uint32_t drain_ms = 1000;
+    uint32_t connected_time = 0;
+    uint32_t reconnected_time = 0;
+    bool disconnected_after_restart = false;
+    uint32_t window_start = 0;
+    uint32_t window_end = duration_ms > drain_ms ? duration_ms - drain_ms : 0;
+    int64_t motion_sent = 0;
+    uint32_t samples_generated = 0;
+    uint32_t edges_sent = 0;
+    // the wheel is toggled between passed through and blocked, and samples whose blocking doesn't match after a grace period are counted
+    const uint32_t control_grace_ms = 100;
+    bool wheel_passthrough = true;
+    uint32_t last_toggle_time = 0, control_toggles = 0, control_mismatches = 0;
+    uint8_t sent_buttons = 0;
+    bool key_held = false, key_forwarded = false;
+    uint32_t key_presses = 0, key_events_forwarded = 0;
+    motion_sent_history = calloc(duration_ms + 1, sizeof(int64_t));
+    if (motion_sent_history == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for (virtual_time = 0; virtual_time <= duration_ms; virtual_time++) {
+        if (hub_restart_ms > 0 && virtual_time == hub_restart_ms) {
+            hub_shutdown();
+            register_dummies();
+        }
+        if (virtual_time % housekeeping_interval_ms == 0) {
+            receiver_pointing_device_task();
+        }
+        deliver_due_messages();
+
+        // housekeeping runs once per matrix scan, which limits each device to one raw hid report per scan
+        if (virtual_time % housekeeping_interval_ms == 0) {
+            receiver_hid_sends_this_tick = 0;
+            uint32_t tasks = pointing_device_tasks;
+            receiver_housekeeping_task_mouse_passthrough();
+            pointing_device_tasks_by_module += pointing_device_tasks - tasks;
+            for (uint32_t i = 0; i < sender_count; i++) {
+                senders[i].hid_sends_this_tick = 0;
+                senders[i].housekeeping();
+            }
+        }
+
+        bool connected = true;
+        for (uint32_t i = 0; i < sender_count; i++) {
+            connected = connected && senders[i].is_connected() && receiver_mouse_passthrough_is_device_connected(i);
+        }
+        if (connected && connected_time == 0) {
+            connected_time = virtual_time;
+            window_start = virtual_time + 100;
+            receiver_mouse_passthrough_set_buttons_state(MOUSE_PASSTHROUGH_ALL_DEVICES, true, true);
+            receiver_mouse_passthrough_set_pointer_state(MOUSE_PASSTHROUGH_ALL_DEVICES, true, true);
+            receiver_mouse_passthrough_set_wheel_state(MOUSE_PASSTHROUGH_ALL_DEVICES, true, true);
+            receiver_mouse_passthrough_set_pointer_filter(MOUSE_PASSTHROUGH_ALL_DEVICES, pointer_filter);
+            receiver_mouse_passthrough_set_keys_state(MOUSE_PASSTHROUGH_ALL_DEVICES, true, true);
+        }
+        if (hub_restart_ms > 0 && virtual_time > hub_restart_ms) {
+            if (!connected) {
+                disconnected_after_restart = true;
+            } else if (disconnected_after_restart && reconnected_time == 0) {
+                reconnected_time = virtual_time;
+            }
+        }
+
+        if (control_toggle_ms > 0 && window_start > 0 && virtual_time >= window_start && virtual_time < window_end && (virtual_time - window_start) % control_toggle_ms == 0) {
+            wheel_passthrough = !wheel_passthrough;
+            receiver_mouse_passthrough_set_wheel_state(MOUSE_PASSTHROUGH_ALL_DEVICES, wheel_passthrough, wheel_passthrough);
+            last_toggle_time = virtual_time;
+            control_toggles++;
+        }
+
+        // each sender clicks its own button, so that the receiver's merged report shows every edge
+        for (uint32_t i = 0; i < sender_count && virtual_time % sample_interval_ms == 0; i++) {
+            uint8_t button = senders[i].button;
+            report_mouse_t mouse = {.buttons = sent_buttons & button};
+            if (window_start > 0 && virtual_time >= window_start && virtual_time < window_end) {
+                // x only moves right and y only moves up, so that summing samples never cancels motion out
+                uint32_t range = (random_next() % 16 == 0) ? 400 : 40;
+                mouse.x = random_next() % (range + 1);
+                mouse.y = -(int32_t)(random_next() % (range + 1));
+                if ((virtual_time - window_start) % 50 == 17 * i) {
+                    mouse.buttons ^= button;
+                    edges_sent++;
+                }
+                motion_sent += mouse.x - mouse.y;
+                samples_generated++;
+            } else if (virtual_time >= window_end && mouse.buttons != 0) {
+                mouse.buttons = 0;
+                edges_sent++;
+            }
+            sent_buttons = (sent_buttons & ~button) | mouse.buttons;
+            if (control_toggle_ms > 0) {
+                mouse.v = 1;
+            }
+            report_mouse_t local = senders[i].pointing_device_task(mouse);
+            if (control_toggle_ms > 0 && connected && virtual_time - last_toggle_time >= control_grace_ms && (local.v == 0) != wheel_passthrough) {
+                control_mismatches++;
+            }
+        }
+
+        // the first sender taps a different key every key interval
+        if (key_interval_ms > 0 && window_start > 0 && virtual_time >= window_start && virtual_time <= window_end) {
+            uint32_t phase = (virtual_time - window_start) % key_interval_ms;
+            bool press = phase == 0 && virtual_time < window_end;
+            bool release = key_held && (phase == key_interval_ms / 2 || virtual_time == window_end);
+            if (press || release) {
+                // with keys sent and blocked, a press that is handled locally wasn't forwarded, and releases follow their press
+                uint16_t keycode = 0x04 + (press ? key_presses : key_presses - 1) % 26;
+                keyrecord_t record = {.event = {.time = sender_timer_read(), .type = KEY_EVENT, .pressed = press}};
+                bool local = sender_process_record_mouse_passthrough(keycode, &record);
+                if (press) {
+                    key_presses++;
+                    key_forwarded = !local;
+                }
+                if (key_forwarded) {
+                    expect_key_event(keycode, press);
+                    key_events_forwarded++;
+                }
+                key_held = press;
+            }
+        }
+
+        motion_sent_history[virtual_time] = motion_sent;
+    }
+
+    uint32_t window_ms = window_end > window_start ? window_end - window_start : 0;
+    printf("senders: %lu, devices: %lu, latency: %lu ms, jitter: %lu ms, loss: %lu permille\n", (unsigned long)sender_count, (unsigned long)device_count, (unsigned long)latency_ms, (unsigned long)jitter_ms, (unsigned long)loss_permille);
+    if (connected_time == 0) {
+        printf("handshake: never completed\n");
+        return 1;
+    }
+    printf("handshake: %lu ms\n", (unsigned long)connected_time);
+    if (hub_restart_ms > 0) {
+        if (reconnected_time > 0) {
+            printf("reconnect after hub restart: %lu ms\n", (unsigned long)(reconnected_time - hub_restart_ms));
+        } else {
+            printf("reconnect after hub restart: never completed\n");
+        }
+    }
+    if (window_ms > 0) {
+        printf("samples: %lu generated (%.0f/s), %lu in %lu data frames (%.2f per frame)\n", (unsigned long)samples_generated, samples_generated * 1000.0 / window_ms, (unsigned long)data_samples, (unsigned long)data_frames, data_frames ? (double)data_samples / data_frames : 0.0);
+    }
+    printf("messages: %lu routed, %lu lost on the link, %lu status broadcasts, %lu extra sends in one tick\n", (unsigned long)messages_routed, (unsigned long)messages_lost, (unsigned long)status_broadcasts, (unsigned long)extra_hid_sends);
+    printf("motion: %lld sent, %lld received (%.2f%%)\n", (long long)motion_sent, (long long)motion_received, motion_sent ? 100.0 * motion_received / motion_sent : 100.0);
+    // lost motion never arrives, so the delay is only meaningful on a lossless link
+    if (motion_delay_samples > 0 && loss_permille == 0) {
+        printf("motion delay: %.1f ms average, %lu ms max\n", (double)motion_delay_total / motion_delay_samples, (unsigned long)motion_delay_max);
+    }
+    printf("receiver pointing device tasks: %lu, %lu run by the module\n", (unsigned long)pointing_device_tasks, (unsigned long)pointing_device_tasks_by_module);
+    printf("button edges: %lu sent, %lu received\n", (unsigned long)edges_sent, (unsigned long)edges_received);
+    if (key_interval_ms > 0) {
+        uint32_t key_events_matched = key_events_received - key_events_caught_up;
+        printf("keys: %lu presses, %lu events forwarded, %lu received in order, %lu missed, %lu caught up, %lu registered, %ld still down\n", (unsigned long)key_presses, (unsigned long)key_events_forwarded, (unsigned long)key_events_matched, (unsigned long)(key_events_missed + keys_expected_count), (unsigned long)key_events_caught_up, (unsigned long)keys_registered, (long)keys_down);
+        printf("key timestamps: %.1f ms late on average\n", key_events_matched ? (double)key_time_error_total / key_events_matched : 0.0);
+    }
+    if (control_toggle_ms > 0) {
+        printf("control: %lu toggles, %lu samples blocked wrongly %lu ms after a toggle\n", (unsigned long)control_toggles, (unsigned long)control_mismatches, (unsigned long)control_grace_ms);
+    }
+
+    mouse_passthrough_stats_t stats;
+    for (uint32_t i = 0; i < sender_count; i++) {
+        senders[i].get_stats(&stats);
+        print_stats(senders[i].name, &stats);
+    }
+    receiver_mouse_passthrough_get_stats(&stats);
+    print_stats("receiver", &stats);
+    free(motion_sent_history);
+    return 0;
+}
@@ -0,0 +1,96 @@
+// Copyright 2025 Morgan Newell Sun
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// The simulator links the sender, second sender, and receiver builds of mouse_passthrough.c into one process.
+// Each role is compiled in its own translation unit with SIM_ROLE defined, which prefixes every
+// global symbol of the module (and every QMK function it calls) with the role name.
+
+#pragma once
+
+#define SIM_CONCAT_(a, b) a##_##b
+#define SIM_CONCAT(a, b) SIM_CONCAT_(a, b)
+
+#ifdef SIM_ROLE
+#    define SIM_NAME(name) SIM_CONCAT(SIM_ROLE, name)
+
+// module API
+#    define keyboard_post_init_mouse_passthrough SIM_NAME(keyboard_post_init_mouse_passthrough)
+#    define housekeeping_task_mouse_passthrough SIM_NAME(housekeeping_task_mouse_passthrough)
+#    define pointing_device_task_mouse_passthrough SIM_NAME(pointing_device_task_mouse_passthrough)
+#    define process_record_mouse_passthrough SIM_NAME(process_record_mouse_passthrough)
+#    define raw_hid_receive SIM_NAME(raw_hid_receive)
+#    define mouse_passthrough_loopback_receive SIM_NAME(mouse_passthrough_loopback_receive)
+#    define pointing_device_driver_get_report SIM_NAME(pointing_device_driver_get_report)
+#    define pointing_device_driver_get_cpi SIM_NAME(pointing_device_driver_get_cpi)
+
+// user API
+#    define is_mouse_passthrough_connected SIM_NAME(is_mouse_passthrough_connected)
+#    define mouse_passthrough_is_device_connected SIM_NAME(mouse_passthrough_is_device_connected)
+#    define mouse_passthrough_set_buttons_state SIM_NAME(mouse_passthrough_set_buttons_state)
+#    define mouse_passthrough_set_pointer_state SIM_NAME(mouse_passthrough_set_pointer_state)
+#    define mouse_passthrough_set_wheel_state SIM_NAME(mouse_passthrough_set_wheel_state)
+#    define mouse_passthrough_set_keys_state SIM_NAME(mouse_passthrough_set_keys_state)
+#    define mouse_passthrough_set_pointer_filter SIM_NAME(mouse_passthrough_set_pointer_filter)
+#    define mouse_passthrough_send_reset_command SIM_NAME(mouse_passthrough_send_reset_command)
+#    define mouse_passthrough_get_stats SIM_NAME(mouse_passthrough_get_stats)
+#    define mouse_passthrough_reset_stats SIM_NAME(mouse_passthrough_reset_stats)
+#    define mouse_passthrough_print_stats SIM_NAME(mouse_passthrough_print_stats)
+
+// QMK functions provided by the simulator
+#    define raw_hid_send SIM_NAME(raw_hid_send)
+#    define mouse_passthrough_loopback_send SIM_NAME(mouse_passthrough_loopback_send)
+#    define reset_keyboard SIM_NAME(reset_keyboard)
+#    define process_record SIM_NAME(process_record)
+#    define process_record_modules SIM_NAME(process_record_modules)
+#    define process_record_kb SIM_NAME(process_record_kb)
+#    define register_code16 SIM_NAME(register_code16)
+#    define unregister_code16 SIM_NAME(unregister_code16)
+#    define pointing_device_task SIM_NAME(pointing_device_task)
+#    define timer_read SIM_NAME(timer_read)
+#    define timer_elapsed SIM_NAME(timer_elapsed)
+#    define timer_read32 SIM_NAME(timer_read32)
+#    define timer_elapsed32 SIM_NAME(timer_elapsed32)
+
+#else
+
+#    include "mouse_passthrough.h"
+
+// the receiver-only constants are not visible here, since neither role is defined in this translation unit
+#    define MOUSE_PASSTHROUGH_ALL_DEVICES 0xFF
+
+#    define SIM_DECLARE_ROLE(role)                                                     \
+        void SIM_CONCAT(role, keyboard_post_init_mouse_passthrough)(void);            \
+        void SIM_CONCAT(role, housekeeping_task_mouse_passthrough)(void);             \
+        void SIM_CONCAT(role, raw_hid_receive)(uint8_t * data, uint8_t length);       \
+        void SIM_CONCAT(role, mouse_passthrough_loopback_receive)(uint8_t * data, uint8_t length); \
+        bool SIM_CONCAT(role, is_mouse_passthrough_connected)(void);                  \
+        void SIM_CONCAT(role, mouse_passthrough_get_stats)(mouse_passthrough_stats_t *); \
+        void SIM_CONCAT(role, raw_hid_send)(uint8_t * data, uint8_t length);          \
+        void SIM_CONCAT(role, reset_keyboard)(void);                                  \
+        bool SIM_CONCAT(role, process_record_mouse_passthrough)(uint16_t keycode, keyrecord_t * record); \
+        void SIM_CONCAT(role, process_record)(keyrecord_t * record);                  \
+        bool SIM_CONCAT(role, process_record_modules)(uint16_t keycode, keyrecord_t * record); \
+        bool SIM_CONCAT(role, process_record_kb)(uint16_t keycode, keyrecord_t * record); \
+        void SIM_CONCAT(role, register_code16)(uint16_t keycode);                     \
+        void SIM_CONCAT(role, unregister_code16)(uint16_t keycode);                   \
+        uint16_t SIM_CONCAT(role, timer_read)(void);                                  \
+        uint16_t SIM_CONCAT(role, timer_elapsed)(uint16_t last);                      \
+        uint32_t SIM_CONCAT(role, timer_read32)(void);                                \
+        uint32_t SIM_CONCAT(role, timer_elapsed32)(uint32_t last);
+
+SIM_DECLARE_ROLE(sender)
+SIM_DECLARE_ROLE(sender2)
+SIM_DECLARE_ROLE(receiver)
+
+report_mouse_t sender_pointing_device_task_mouse_passthrough(report_mouse_t mouse);
+report_mouse_t sender2_pointing_device_task_mouse_passthrough(report_mouse_t mouse);
+report_mouse_t receiver_pointing_device_driver_get_report(report_mouse_t mouse);
+bool receiver_mouse_passthrough_is_device_connected(uint8_t device);
+void receiver_mouse_passthrough_set_buttons_state(uint8_t device, bool send, bool block);
+void receiver_mouse_passthrough_set_pointer_state(uint8_t device, bool send, bool block);
+void receiver_mouse_passthrough_set_wheel_state(uint8_t device, bool send, bool block);
+void receiver_mouse_passthrough_set_keys_state(uint8_t device, bool send, bool block);
+void receiver_mouse_passthrough_set_pointer_filter(uint8_t device, mouse_passthrough_pointer_filter_t filter);
+bool receiver_pointing_device_task(void);
+
+#endif
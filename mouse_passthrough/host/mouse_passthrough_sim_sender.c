@@ -0,0 +1,11 @@
+// Copyright 2025 Morgan Newell Sun
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Sender build of mouse_passthrough.c for the simulator, see mouse_passthrough_sim.h.
+
+#define MOUSE_PASSTHROUGH_SENDER
+#define SIM_ROLE sender
+#define QMK_KEYBOARD_H "quantum.h"
+#include "mouse_passthrough_sim.h"
+#include "../post_config.h"
+#include "../mouse_passthrough.c"
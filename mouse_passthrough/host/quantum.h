@@ -0,0 +1,71 @@
+// Copyright 2025 Morgan Newell Sun
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Minimal stand-in for QMK's quantum.h, just enough to build mouse_passthrough.c on a host PC.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ASSERT_COMMUNITY_MODULES_MIN_API_VERSION(major, minor, patch)
+
+typedef int16_t mouse_xy_report_t;
+typedef int8_t mouse_hv_report_t;
+
+typedef struct {
+    uint8_t buttons;
+    mouse_xy_report_t x;
+    mouse_xy_report_t y;
+    mouse_hv_report_t v;
+    mouse_hv_report_t h;
+} report_mouse_t;
+
+typedef struct {
+    uint8_t col;
+    uint8_t row;
+} keypos_t;
+
+typedef enum keyevent_type_t {
+    TICK_EVENT = 0,
+    KEY_EVENT = 1,
+} keyevent_type_t;
+
+typedef struct {
+    keypos_t key;
+    uint16_t time;
+    keyevent_type_t type;
+    bool pressed;
+} keyevent_t;
+
+typedef struct {
+    keyevent_t event;
+#if defined(COMBO_ENABLE) || defined(REPEAT_KEY_ENABLE)
+    uint16_t keycode;
+#endif
+} keyrecord_t;
+
+#define KC_NO 0x0000
+#define QK_MODS_MAX 0x1FFF
+
+enum mouse_passthrough_keycodes {
+    KC_RESET_OTHER = 0x7E00,
+    KC_MOUSE_PASSTHROUGH_STATS,
+};
+
+uint16_t timer_read(void);
+uint16_t timer_elapsed(uint16_t last);
+uint32_t timer_read32(void);
+uint32_t timer_elapsed32(uint32_t last);
+
+void raw_hid_send(uint8_t *data, uint8_t length);
+void reset_keyboard(void);
+void process_record(keyrecord_t *record);
+bool process_record_modules(uint16_t keycode, keyrecord_t *record);
+bool process_record_kb(uint16_t keycode, keyrecord_t *record);
+void register_code16(uint16_t keycode);
+void unregister_code16(uint16_t keycode);
+bool pointing_device_task(void);
@@ -3,10 +3,536 @@
 
 #include "mouse_passthrough.h"
 #include QMK_KEYBOARD_H
-#include "raw_hid.h"
+#include "mouse_passthrough_codec.h"
+#if defined(MOUSE_PASSTHROUGH_TRANSPORT_SPLIT)
+#    include "transactions.h"
+#elif !defined(MOUSE_PASSTHROUGH_TRANSPORT_LOOPBACK)
+#    include "raw_hid.h"
+#endif
+#ifdef CONSOLE_ENABLE
+#    include "print.h"
+#endif
+#ifdef MOUSE_PASSTHROUGH_EECONFIG_USER_DATA_OFFSET
+#    include "eeconfig.h"
+#endif
+
+// the sender's axis snapping filter is mouse_axis_snapping's, if that module is part of the build
+#if defined(MOUSE_PASSTHROUGH_SENDER) && __has_include("mouse_axis_snapping.h")
+#    include "mouse_axis_snapping.h"
+#    define MOUSE_PASSTHROUGH_AXIS_SNAPPING_FILTER
+#endif
+
+// the dragscroll filter sends motion as often as hires_dragscroll scrolls, whose config is only visible here and not in post_config.h
+#if defined(MOUSE_PASSTHROUGH_RECEIVER) && !defined(MOUSE_PASSTHROUGH_DRAGSCROLL_INTERVAL)
+#    ifdef HIRES_DRAGSCROLL_THROTTLE_MS
+#        define MOUSE_PASSTHROUGH_DRAGSCROLL_INTERVAL HIRES_DRAGSCROLL_THROTTLE_MS
+#    else
+#        define MOUSE_PASSTHROUGH_DRAGSCROLL_INTERVAL 0
+#    endif
+#endif
+#if defined(MOUSE_PASSTHROUGH_RECEIVER) && MOUSE_PASSTHROUGH_DRAGSCROLL_INTERVAL > 255
+#    error "MOUSE_PASSTHROUGH_DRAGSCROLL_INTERVAL must be at most 255!"
+#endif
 
 ASSERT_COMMUNITY_MODULES_MIN_API_VERSION(1, 1, 0);
 
+// ============================================================================
+// STATISTICS
+// ============================================================================
+
+static mouse_passthrough_stats_t stats = {0};
+static uint16_t rtt_histogram[MOUSE_PASSTHROUGH_RTT_BUCKETS] = {0};
+static uint32_t last_ping_time = 0;
+
+static void record_rtt(uint16_t rtt) {
+    uint8_t bucket = rtt / MOUSE_PASSTHROUGH_RTT_BUCKET_MS;
+    if (bucket >= MOUSE_PASSTHROUGH_RTT_BUCKETS) {
+        bucket = MOUSE_PASSTHROUGH_RTT_BUCKETS - 1;
+    }
+    rtt_histogram[bucket]++;
+    stats.rtt_last_ms = rtt;
+}
+
+// upper edge of the histogram bucket that contains the given percentile
+static uint16_t rtt_percentile(uint8_t percent) {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_RTT_BUCKETS; i++) {
+        total += rtt_histogram[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    uint32_t threshold = (total * percent + 99) / 100;
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_RTT_BUCKETS; i++) {
+        cumulative += rtt_histogram[i];
+        if (cumulative >= threshold) {
+            return (i + 1) * MOUSE_PASSTHROUGH_RTT_BUCKET_MS;
+        }
+    }
+    return MOUSE_PASSTHROUGH_RTT_BUCKETS * MOUSE_PASSTHROUGH_RTT_BUCKET_MS;
+}
+
+// ============================================================================
+// TRANSPORT
+// ============================================================================
+
+// by default messages go through the raw hid hub on the host PC, the other transports connect the two devices directly
+// those stand in for the hub: registrations are answered locally with a device list that only holds the peer,
+// and messages from the peer are stamped with its device id, so the rest of the module works the same over every transport
+
+static void receive_message(uint8_t *data, uint8_t length);
+
+#if !defined(MOUSE_PASSTHROUGH_TRANSPORT_SPLIT) && !defined(MOUSE_PASSTHROUGH_TRANSPORT_LOOPBACK)
+
+static void transport_init(void) {}
+
+static void transport_task(void) {}
+
+// returns false if the transport can't take the message yet
+static bool transport_send(uint8_t *data) {
+    raw_hid_send(data, QMK_RAW_HID_REPORT_SIZE);
+    return true;
+}
+
+void raw_hid_receive(uint8_t *data, uint8_t length) {
+    receive_message(data, length);
+}
+
+#else
+
+#    ifdef MOUSE_PASSTHROUGH_SENDER
+#        define DIRECT_DEVICE_ID_SELF 1
+#        define DIRECT_DEVICE_ID_PEER 0
+#    else
+#        define DIRECT_DEVICE_ID_SELF 0
+#        define DIRECT_DEVICE_ID_PEER 1
+#    endif
+
+static bool direct_device_list_due = false;
+
+// returns true if the message has to go over the link, registrations are answered on the next transport task instead
+static bool direct_route(const uint8_t *data) {
+    if (frame_device_id(data) == DEVICE_ID_HUB) {
+        if (decode_registration(data)) {
+            direct_device_list_due = true;
+        }
+        return false;
+    }
+    return frame_device_id(data) == DIRECT_DEVICE_ID_PEER;
+}
+
+static void direct_receive(uint8_t *data, uint8_t length) {
+    if (length < QMK_RAW_HID_REPORT_SIZE || frame_command_id(data) != RAW_HID_HUB_COMMAND_ID) {
+        return;
+    }
+    set_frame_device_id(data, DIRECT_DEVICE_ID_PEER);
+    receive_message(data, length);
+}
+
+static void direct_task(void) {
+    if (!direct_device_list_due) {
+        return;
+    }
+    direct_device_list_due = false;
+    uint8_t device_id_others[MAX_REGISTERED_DEVICES - 1];
+    memset(device_id_others, DEVICE_ID_UNASSIGNED, sizeof(device_id_others));
+    device_id_others[0] = DIRECT_DEVICE_ID_PEER;
+    uint8_t status[QMK_RAW_HID_REPORT_SIZE];
+    encode_header(status, DEVICE_ID_HUB);
+    encode_device_list(status, DIRECT_DEVICE_ID_SELF, device_id_others);
+    receive_message(status, sizeof(status));
+}
+
+#    ifdef MOUSE_PASSTHROUGH_TRANSPORT_SPLIT
+// the master half exchanges one message each way with the other half in a split transaction: its own message (if any) goes in the
+// request and the other half's comes back in the reply, which uses the device id byte to say whether the request's message was taken
+static uint8_t split_outbox[QMK_RAW_HID_REPORT_SIZE];
+static volatile bool split_outbox_full = false;
+static uint8_t split_inbox[QMK_RAW_HID_REPORT_SIZE];
+static volatile bool split_inbox_full = false;
+static uint16_t last_split_poll_time = 0;
+
+// runs on the slave half, so incoming messages are only handed over here and processed in the next transport task
+static void split_rpc_handler(uint8_t in_buflen, const void *in_data, uint8_t out_buflen, void *out_data) {
+    const uint8_t *request = in_data;
+    uint8_t *reply = out_data;
+    if (out_buflen < QMK_RAW_HID_REPORT_SIZE) {
+        return;
+    }
+    bool taken = false;
+    if (in_buflen >= QMK_RAW_HID_REPORT_SIZE && frame_command_id(request) == RAW_HID_HUB_COMMAND_ID && !split_inbox_full) {
+        memcpy(split_inbox, request, QMK_RAW_HID_REPORT_SIZE);
+        split_inbox_full = true;
+        taken = true;
+    }
+    if (split_outbox_full) {
+        memcpy(reply, split_outbox, QMK_RAW_HID_REPORT_SIZE);
+        split_outbox_full = false;
+    } else {
+        // no message, which the master drops by its command id
+        reply[offsetof(frame_header_t, command_id)] = 0;
+    }
+    set_frame_device_id(reply, taken ? 1 : 0);
+}
+
+static void transport_init(void) {
+    transaction_register_rpc(MOUSE_PASSTHROUGH_SPLIT_RPC, split_rpc_handler);
+}
+
+static void transport_task(void) {
+    direct_task();
+    if (!is_keyboard_master()) {
+        if (split_inbox_full) {
+            uint8_t message[QMK_RAW_HID_REPORT_SIZE];
+            memcpy(message, split_inbox, QMK_RAW_HID_REPORT_SIZE);
+            split_inbox_full = false;
+            direct_receive(message, sizeof(message));
+        }
+        return;
+    }
+    // the other half can only send when polled
+    if (!split_outbox_full && timer_elapsed(last_split_poll_time) < MOUSE_PASSTHROUGH_SPLIT_POLL_INTERVAL) {
+        return;
+    }
+    last_split_poll_time = timer_read();
+    uint8_t request[QMK_RAW_HID_REPORT_SIZE] = {0};
+    uint8_t reply[QMK_RAW_HID_REPORT_SIZE];
+    if (split_outbox_full) {
+        memcpy(request, split_outbox, QMK_RAW_HID_REPORT_SIZE);
+    }
+    if (!transaction_rpc_exec(MOUSE_PASSTHROUGH_SPLIT_RPC, QMK_RAW_HID_REPORT_SIZE, request, QMK_RAW_HID_REPORT_SIZE, reply)) {
+        return;
+    }
+    if (frame_device_id(reply) != 0) {
+        split_outbox_full = false;
+    }
+    direct_receive(reply, sizeof(reply));
+}
+
+static bool transport_send(uint8_t *data) {
+    if (!direct_route(data)) {
+        return true;
+    }
+    if (split_outbox_full) {
+        return false;
+    }
+    memcpy(split_outbox, data, QMK_RAW_HID_REPORT_SIZE);
+    split_outbox_full = true;
+    return true;
+}
+#    else
+static void transport_init(void) {}
+
+static void transport_task(void) {
+    direct_task();
+}
+
+static bool transport_send(uint8_t *data) {
+    if (direct_route(data)) {
+        mouse_passthrough_loopback_send(data, QMK_RAW_HID_REPORT_SIZE);
+    }
+    return true;
+}
+
+void mouse_passthrough_loopback_receive(uint8_t *data, uint8_t length) {
+    direct_receive(data, length);
+}
+#    endif
+
+#endif
+
+// ============================================================================
+// MESSAGE QUEUE
+// ============================================================================
+
+// outgoing messages are queued in separate FIFO lanes, and the lanes are drained in strict priority order
+typedef enum message_lane_t {
+    MESSAGE_LANE_CONTROL = 0,  // block/send control payloads and reset commands
+    MESSAGE_LANE_BUTTONS,      // data payloads that carry a button edge
+    MESSAGE_LANE_MOTION,       // data payloads that only carry pointer/wheel motion
+    MESSAGE_LANE_LINK,         // registration and handshake reports
+    MESSAGE_LANE_COUNT,
+} message_lane_t;
+
+typedef struct message_lane_queue_t {
+    uint8_t first_slot;
+    uint8_t depth;
+    uint8_t head;
+    uint8_t count;
+} message_lane_queue_t;
+
+#define MESSAGE_QUEUE_SLOTS (MAX_QUEUED_CONTROL_MESSAGES + MAX_QUEUED_BUTTON_MESSAGES + MAX_QUEUED_MOTION_MESSAGES + MAX_QUEUED_LINK_MESSAGES)
+
+static uint8_t message_queue[MESSAGE_QUEUE_SLOTS][QMK_RAW_HID_REPORT_SIZE];
+static message_lane_queue_t message_lanes[MESSAGE_LANE_COUNT] = {
+    [MESSAGE_LANE_CONTROL] = { .first_slot = 0, .depth = MAX_QUEUED_CONTROL_MESSAGES },
+    [MESSAGE_LANE_BUTTONS] = { .first_slot = MAX_QUEUED_CONTROL_MESSAGES, .depth = MAX_QUEUED_BUTTON_MESSAGES },
+    [MESSAGE_LANE_MOTION] = { .first_slot = MAX_QUEUED_CONTROL_MESSAGES + MAX_QUEUED_BUTTON_MESSAGES, .depth = MAX_QUEUED_MOTION_MESSAGES },
+    [MESSAGE_LANE_LINK] = { .first_slot = MAX_QUEUED_CONTROL_MESSAGES + MAX_QUEUED_BUTTON_MESSAGES + MAX_QUEUED_MOTION_MESSAGES, .depth = MAX_QUEUED_LINK_MESSAGES },
+};
+
+// reserve a message at the back of a lane, addressed to device_id, only its header is written and the caller encodes the frame
+// returns NULL if the lane is full
+static uint8_t *message_queue_push(message_lane_t lane, uint8_t device_id) {
+    message_lane_queue_t *queue = &message_lanes[lane];
+    if (queue->count >= queue->depth) {
+        stats.queue_full++;
+        return NULL;
+    }
+    uint8_t *message = message_queue[queue->first_slot + (queue->head + queue->count) % queue->depth];
+    queue->count++;
+    uint8_t depth = 0;
+    for (uint8_t i = 0; i < MESSAGE_LANE_COUNT; i++) {
+        depth += message_lanes[i].count;
+    }
+    if (depth > stats.max_queue_depth) {
+        stats.max_queue_depth = depth;
+    }
+    encode_header(message, device_id);
+    return message;
+}
+
+#ifdef MOUSE_PASSTHROUGH_SENDER
+// newest message in a lane that has not been sent yet, or NULL if the lane is empty
+static uint8_t *message_queue_tail(message_lane_t lane) {
+    message_lane_queue_t *queue = &message_lanes[lane];
+    if (queue->count == 0) {
+        return NULL;
+    }
+    return message_queue[queue->first_slot + (queue->head + queue->count - 1) % queue->depth];
+}
+
+// take the oldest unsent message out of a lane, or NULL if the lane is empty
+static uint8_t *message_queue_pop(message_lane_t lane) {
+    message_lane_queue_t *queue = &message_lanes[lane];
+    if (queue->count == 0) {
+        return NULL;
+    }
+    uint8_t *message = message_queue[queue->first_slot + queue->head];
+    queue->head = (queue->head + 1) % queue->depth;
+    queue->count--;
+    return message;
+}
+#endif
+
+// send the oldest message from the highest priority lane that has one
+static void message_queue_send_next(void) {
+    for (uint8_t lane = 0; lane < MESSAGE_LANE_COUNT; lane++) {
+        message_lane_queue_t *queue = &message_lanes[lane];
+        if (queue->count > 0) {
+            uint8_t *message = message_queue[queue->first_slot + queue->head];
+            if (frame_type(message) == REPORT_FRAME_PING) {
+                // stamp pings as late as possible so that the round trip doesn't include time spent queued
+                stamp_ping(message, timer_read());
+            }
+            if (!transport_send(message)) {
+                return;
+            }
+            stats.messages_sent++;
+            queue->head = (queue->head + 1) % queue->depth;
+            queue->count--;
+            return;
+        }
+    }
+}
+
+// ============================================================================
+// PING
+// ============================================================================
+
+// ping the device if a heartbeat is due or the ping interval has elapsed, returns true if it was time to ping
+static bool ping_task(bool connected, uint8_t device_id, bool heartbeat) {
+    if (!connected) {
+        return false;
+    }
+#if MOUSE_PASSTHROUGH_PING_INTERVAL > 0
+    heartbeat = heartbeat || timer_elapsed32(last_ping_time) > MOUSE_PASSTHROUGH_PING_INTERVAL;
+#endif
+    if (!heartbeat) {
+        return false;
+    }
+    last_ping_time = timer_read32();
+    uint8_t *message = message_queue_push(MESSAGE_LANE_CONTROL, device_id);
+    if (message != NULL) {
+        encode_ping(message);
+        stats.pings_sent++;
+    }
+    return true;
+}
+
+// answer pings and record pongs from the remote, returns false for any other frame
+static bool process_ping_frame(const uint8_t *data) {
+    if (frame_type(data) == REPORT_FRAME_PING) {
+        uint8_t *message = message_queue_push(MESSAGE_LANE_CONTROL, frame_device_id(data));
+        if (message != NULL) {
+            encode_pong(message, decode_ping(data), &stats);
+        }
+        return true;
+    }
+    if (frame_type(data) == REPORT_FRAME_PONG) {
+        stats.pongs_received++;
+        record_rtt(timer_read() - decode_pong(data, &stats));
+        return true;
+    }
+    return false;
+}
+
+// ============================================================================
+// CONNECTION
+// ============================================================================
+
+static uint32_t last_connection_success_time = 0;  // last time anything was received through the hub
+static uint32_t last_connection_attempt_time = 0;
+static uint32_t connection_attempt_interval = 0;  // 0 means the next attempt is due immediately
+
+// the hub hands out device ids again when it restarts, so each cached peer is kept along with the id we had when we paired with it
+typedef struct peer_cache_entry_t {
+    uint8_t device_id;
+    uint8_t device_id_self;
+} peer_cache_entry_t;
+
+typedef struct peer_cache_t {
+    uint8_t magic;  // PEER_CACHE_MAGIC once the cache has been written
+    peer_cache_entry_t entries[MOUSE_PASSTHROUGH_PEER_CACHE_SIZE];
+} peer_cache_t;
+
+#define PEER_CACHE_MAGIC 0xA5
+
+static peer_cache_t peer_cache;
+
+// while unpaired, registration goes out immediately on boot and after a disconnect, then backs off exponentially while it gets no reply
+// while paired, registration isn't needed, the heartbeat keeps the connection alive instead
+static bool connection_attempt_due(void) {
+    if (connection_attempt_interval > 0 && timer_elapsed32(last_connection_attempt_time) <= connection_attempt_interval) {
+        return false;
+    }
+    last_connection_attempt_time = timer_read32();
+    if (connection_attempt_interval == 0) {
+        connection_attempt_interval = HUB_CONNECTION_RETRY_INTERVAL;
+    } else {
+        connection_attempt_interval *= 2;
+    }
+    if (connection_attempt_interval > HUB_CONNECTION_ATTEMPT_INTERVAL) {
+        connection_attempt_interval = HUB_CONNECTION_ATTEMPT_INTERVAL;
+    }
+    return true;
+}
+
+// a paired link that has been quiet for MOUSE_PASSTHROUGH_HEARTBEAT_INTERVAL pings the remote, and the pong proves that the
+// hub and the remote are still there, so there's no heartbeat at all while data is flowing in
+static bool heartbeat_due(void) {
+    return timer_elapsed32(last_connection_success_time) > MOUSE_PASSTHROUGH_HEARTBEAT_INTERVAL && timer_elapsed32(last_ping_time) > MOUSE_PASSTHROUGH_HEARTBEAT_INTERVAL;
+}
+
+// restart the backoff, so that the next housekeeping pass attempts to connect
+static void connection_attempt_now(void) {
+    connection_attempt_interval = 0;
+}
+
+static bool device_list_contains(const uint8_t *device_ids, uint8_t device_id) {
+    if (device_id == DEVICE_ID_UNASSIGNED) {
+        return false;
+    }
+    for (uint8_t i = 0; i < MAX_REGISTERED_DEVICES - 1; i++) {
+        if (device_ids[i] == device_id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void peer_cache_load(void) {
+#ifdef MOUSE_PASSTHROUGH_EECONFIG_USER_DATA_OFFSET
+    if (eeconfig_is_user_datablock_valid()) {
+        eeconfig_read_user_datablock(&peer_cache, MOUSE_PASSTHROUGH_EECONFIG_USER_DATA_OFFSET, sizeof(peer_cache));
+    }
+    if (peer_cache.magic == PEER_CACHE_MAGIC) {
+        return;
+    }
+#endif
+    peer_cache.magic = PEER_CACHE_MAGIC;
+    memset(peer_cache.entries, DEVICE_ID_UNASSIGNED, sizeof(peer_cache.entries));
+}
+
+// move a newly paired peer to the front of the cache, dropping the least recently paired one if it's full
+static void peer_cache_store(uint8_t device_id, uint8_t device_id_self) {
+    uint8_t i = 0;
+    while (i + 1 < MOUSE_PASSTHROUGH_PEER_CACHE_SIZE && peer_cache.entries[i].device_id != device_id) {
+        i++;
+    }
+    if (i == 0 && peer_cache.entries[0].device_id == device_id && peer_cache.entries[0].device_id_self == device_id_self) {
+        return;
+    }
+    memmove(peer_cache.entries + 1, peer_cache.entries, i * sizeof(peer_cache_entry_t));
+    peer_cache.entries[0].device_id = device_id;
+    peer_cache.entries[0].device_id_self = device_id_self;
+#ifdef MOUSE_PASSTHROUGH_EECONFIG_USER_DATA_OFFSET
+    eeconfig_update_user_datablock(&peer_cache, MOUSE_PASSTHROUGH_EECONFIG_USER_DATA_OFFSET, sizeof(peer_cache));
+#endif
+}
+
+// a cached peer is only trusted while the hub lists it and still knows us by the id we had when we paired with it,
+// otherwise the hub has restarted since then and the cached id may belong to some other device by now
+static bool peer_cache_is_current(uint8_t index, uint8_t device_id_self, const uint8_t *device_ids) {
+    const peer_cache_entry_t *entry = &peer_cache.entries[index];
+    return entry->device_id_self == device_id_self && device_list_contains(device_ids, entry->device_id);
+}
+
+// ============================================================================
+// CAPABILITIES
+// ============================================================================
+
+#define SUPPORTED_FRAME_FORMATS (CAPABILITY_FRAME_LEGACY | CAPABILITY_FRAME_PACKED)
+#define SUPPORTED_FEATURES (CAPABILITY_FEATURE_CONTROL_ACK | CAPABILITY_FEATURE_CREDIT | CAPABILITY_FEATURE_POINTER_FILTER | CAPABILITY_FEATURE_KEYS)
+
+// what both ends of a link support, the sender picks the data frame format from frame_formats
+typedef struct link_capabilities_t {
+    uint8_t frame_formats;
+    uint8_t report_size;
+    uint8_t features;
+} link_capabilities_t;
+
+// handshake messages carry our own capabilities
+static void write_handshake(uint8_t *message, uint8_t step) {
+    handshake_t handshake = {
+        .step = step,
+        .version = MOUSE_PASSTHROUGH_PROTOCOL_VERSION,
+        .report_size = QMK_RAW_HID_REPORT_SIZE,
+        .frame_formats = SUPPORTED_FRAME_FORMATS,
+        .features = SUPPORTED_FEATURES,
+    };
+    encode_handshake(message, &handshake);
+}
+
+// intersect the capabilities in a handshake message with our own, a peer that doesn't send any gets the legacy layout
+static link_capabilities_t read_capabilities(const uint8_t *data) {
+    link_capabilities_t capabilities = {
+        .frame_formats = CAPABILITY_FRAME_LEGACY,
+        .report_size = MOUSE_PASSTHROUGH_LEGACY_REPORT_SIZE,
+        .features = 0,
+    };
+    handshake_t handshake;
+    decode_handshake(data, &handshake);
+    if (handshake.version > 0) {
+        capabilities.frame_formats = handshake.frame_formats & SUPPORTED_FRAME_FORMATS;
+        capabilities.report_size = handshake.report_size;
+        capabilities.features = handshake.features;
+    }
+    if (capabilities.frame_formats == 0) {
+        // every version reads legacy frames, whatever it advertises
+        capabilities.frame_formats = CAPABILITY_FRAME_LEGACY;
+    }
+    if (capabilities.report_size > QMK_RAW_HID_REPORT_SIZE) {
+        capabilities.report_size = QMK_RAW_HID_REPORT_SIZE;
+    }
+    if (capabilities.report_size < MOUSE_PASSTHROUGH_LEGACY_REPORT_SIZE) {
+        capabilities.report_size = MOUSE_PASSTHROUGH_LEGACY_REPORT_SIZE;
+    }
+    capabilities.features &= SUPPORTED_FEATURES;
+    return capabilities;
+}
+
 #ifdef MOUSE_PASSTHROUGH_SENDER
 
 // ============================================================================
@@ -17,13 +543,16 @@ static uint8_t state;
 static uint8_t device_id_self;
 static uint8_t device_id_others[MAX_REGISTERED_DEVICES - 1];
 static uint8_t device_id_remote;
-static uint32_t last_connection_attempt_time;
-static uint32_t last_connection_success_time;
-static uint8_t message_queue[QMK_RAW_HID_REPORT_SIZE * MAX_QUEUED_MESSAGES];
-static uint8_t message_queue_next_empty_offset = 0;
+static bool device_list_valid = false;  // device_id_others is only meaningful once the hub has sent a device list
+static uint8_t broadcast_cursor = 0;
+static uint8_t broadcast_remaining = 0;  // devices left to visit in the current handshake broadcast
 
 static uint8_t last_buttons_received = 0;
 static uint8_t last_buttons_sent = 0;
+static int32_t pending_x = 0;
+static int32_t pending_y = 0;
+static int32_t pending_v = 0;
+static int32_t pending_h = 0;
 static bool block_buttons_on = false;
 static bool block_buttons_on_queued = false;
 static bool block_pointer_on = false;
@@ -32,47 +561,382 @@ static bool send_buttons_on = false;
 static bool send_buttons_off_queued = false;
 static bool send_pointer_on = false;
 static bool send_wheel_on = false;
+static bool block_keys_on = false;
+static bool send_keys_on = false;
+static uint16_t forwarded_keys[MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS];  // held keys whose press was forwarded, KC_NO for free slots
+static uint16_t last_key_frame_time = 0;
+static uint8_t key_refreshes_left = 0;  // refreshes still to send after the last release
+#    define KEY_REFRESHES_AFTER_RELEASE 2
+static uint8_t last_control_sequence = 0;
+static bool reset_requested = false;  // reset once the acknowledgement of the reset command has been sent
+static uint8_t send_interval = 0;  // minimum ms between motion samples, motion in between stays pending
+static uint16_t last_motion_sample_time = 0;
+static uint16_t last_send_interval_change_time = 0;
+static uint8_t receiver_credit = MOUSE_PASSTHROUGH_CREDIT_NONE;
+static uint8_t pointer_filter = MOUSE_PASSTHROUGH_POINTER_FILTER_NONE;
+static uint8_t pointer_filter_interval = 0;
+static link_capabilities_t link_capabilities = {.frame_formats = CAPABILITY_FRAME_LEGACY, .report_size = MOUSE_PASSTHROUGH_LEGACY_REPORT_SIZE, .features = 0};  // agreed with the remote during the handshake
+
+#    ifdef MOUSE_PASSTHROUGH_AXIS_SNAPPING_FILTER
+static mouse_axis_snapping_filter_t axis_snapping_filter = {0};
+#    endif
+
+// ============================================================================
+// INTERNAL FUNCTIONS
+// ============================================================================
+
+// offset (within the samples) and timestamp of the last sample in a non-empty packed frame
+static uint8_t packed_frame_last_sample(const packed_frame_t *frame, uint16_t *time) {
+    packed_sample_t sample;
+    uint8_t offset = 0;
+    *time = read_uint16(&frame->time);
+    for (uint8_t i = 0; i < frame->count; i++) {
+        uint8_t next = decode_packed_sample(frame->samples, offset, &sample);
+        *time += sample.dt;
+        if (i + 1 == frame->count) {
+            break;
+        }
+        offset = next;
+    }
+    return offset;
+}
+
+// the newest unsent packed frame in a lane that is addressed to the current remote, or NULL
+static packed_frame_t *packed_frame_tail(message_lane_t lane) {
+    uint8_t *frame = message_queue_tail(lane);
+    if (frame == NULL || frame_device_id(frame) != device_id_remote || frame_type(frame) != REPORT_FRAME_PACKED) {
+        return NULL;
+    }
+    return (packed_frame_t *)frame;
+}
+
+static int16_t clamp_to_int16(int32_t value) {
+    return value < INT16_MIN ? INT16_MIN : (value > INT16_MAX ? INT16_MAX : (int16_t)value);
+}
+
+// move as much pending motion as fits into a sample
+static void take_pending_motion(packed_sample_t *sample) {
+    sample->x = clamp_to_int16(pending_x + sample->x);
+    sample->y = clamp_to_int16(pending_y + sample->y);
+    sample->v = clamp_to_int16(pending_v + sample->v);
+    sample->h = clamp_to_int16(pending_h + sample->h);
+}
+
+static void clear_pending_motion(const packed_sample_t *original, const packed_sample_t *sample) {
+    pending_x -= sample->x - original->x;
+    pending_y -= sample->y - original->y;
+    pending_v -= sample->v - original->v;
+    pending_h -= sample->h - original->h;
+}
+
+// append a sample to the newest unsent frame in the lane, starting a new frame if it doesn't fit
+static bool enqueue_packed_sample(message_lane_t lane, const packed_sample_t *sample) {
+    uint16_t now = timer_read();
+    packed_sample_t timed_sample = *sample;
+    uint8_t encoded[PACKED_SAMPLE_MAX_LENGTH];
+    uint8_t length = 0;
+    uint8_t offset = 0;
+
+    packed_frame_t *frame = packed_frame_tail(lane);
+    if (frame != NULL) {
+        uint16_t last_time;
+        offset = packed_frame_last_sample(frame, &last_time);
+        offset += packed_sample_length(frame->samples[offset]);
+        uint16_t dt = now - last_time;
+        timed_sample.dt = (dt > UINT8_MAX) ? UINT8_MAX : dt;
+        length = encode_packed_sample(encoded, &timed_sample);
+    }
+    if (frame == NULL || sizeof(packed_frame_t) + offset + length > link_capabilities.report_size) {
+        uint8_t *message = message_queue_push(lane, device_id_remote);
+        if (message == NULL) {
+            return false;
+        }
+        encode_packed_frame(message, now);
+        frame = (packed_frame_t *)message;
+        offset = 0;
+        timed_sample.dt = 0;
+        length = encode_packed_sample(encoded, &timed_sample);
+    }
+    memcpy(frame->samples + offset, encoded, length);
+    frame->count++;
+    return true;
+}
+
+// peers that only read legacy data frames get a frame per sample, and every frame carries the buttons they have been sent
+static bool enqueue_legacy_sample(message_lane_t lane, const packed_sample_t *sample) {
+    uint8_t *frame = message_queue_push(lane, device_id_remote);
+    if (frame == NULL) {
+        return false;
+    }
+    packed_sample_t legacy_sample = *sample;
+    if (!(sample->flags & PACKED_SAMPLE_BUTTONS)) {
+        legacy_sample.buttons = last_buttons_sent;
+    }
+    encode_legacy_sample(frame, &legacy_sample);
+    return true;
+}
+
+// samples go out in packed frames if both ends support them, and in legacy data frames otherwise
+static bool enqueue_sample(message_lane_t lane, const packed_sample_t *sample) {
+    if (link_capabilities.frame_formats & CAPABILITY_FRAME_PACKED) {
+        return enqueue_packed_sample(lane, sample);
+    }
+    return enqueue_legacy_sample(lane, sample);
+}
+
+// when the motion lane is full, sum pending motion into the last sample of the newest unsent motion frame
+// whatever doesn't fit stays pending for the next pointing device task
+static void coalesce_pending_motion(void) {
+    uint8_t *tail = message_queue_tail(MESSAGE_LANE_MOTION);
+    if (tail != NULL && frame_device_id(tail) == device_id_remote && frame_type(tail) == REPORT_FRAME_LEGACY) {
+        packed_sample_t original;
+        decode_legacy_sample(tail, &original);
+        packed_sample_t sample = original;
+        take_pending_motion(&sample);
+        encode_legacy_sample(tail, &sample);
+        clear_pending_motion(&original, &sample);
+        stats.coalesced++;
+        return;
+    }
+    packed_frame_t *frame = packed_frame_tail(MESSAGE_LANE_MOTION);
+    if (frame == NULL || frame->count == 0) {
+        return;
+    }
+    uint16_t last_time;
+    uint8_t offset = packed_frame_last_sample(frame, &last_time);
+    packed_sample_t original;
+    decode_packed_sample(frame->samples, offset, &original);
+    packed_sample_t sample = original;
+    take_pending_motion(&sample);
+
+    uint8_t encoded[PACKED_SAMPLE_MAX_LENGTH];
+    uint8_t length = encode_packed_sample(encoded, &sample);
+    if (sizeof(packed_frame_t) + offset + length > link_capabilities.report_size) {
+        return;
+    }
+    memcpy(frame->samples + offset, encoded, length);
+    clear_pending_motion(&original, &sample);
+    stats.coalesced++;
+}
+
+// button edges overtake the motion lane, so the motion still queued there is taken back into the pending motion, which goes out
+// in the same sample as the edge, and motion and clicks reach the receiver in the order they happened
+static void take_queued_motion(void) {
+    for (uint8_t *frame = message_queue_pop(MESSAGE_LANE_MOTION); frame != NULL; frame = message_queue_pop(MESSAGE_LANE_MOTION)) {
+        if (frame_device_id(frame) != device_id_remote) {
+            continue;
+        }
+        bool legacy = frame_type(frame) == REPORT_FRAME_LEGACY;
+        const packed_frame_t *packed = (const packed_frame_t *)frame;
+        uint8_t count = legacy ? 1 : packed->count;
+        uint8_t offset = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            packed_sample_t sample;
+            if (legacy) {
+                decode_legacy_sample(frame, &sample);
+            } else {
+                offset = decode_packed_sample(packed->samples, offset, &sample);
+            }
+            pending_x += sample.x;
+            pending_y += sample.y;
+            pending_v += sample.v;
+            pending_h += sample.h;
+        }
+    }
+}
+
+// slot of a forwarded key that is held down, or the first free slot for KC_NO, -1 if there is none
+static int8_t forwarded_key_slot(uint16_t keycode) {
+    for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS; i++) {
+        if (forwarded_keys[i] == keycode) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// key events share the button lane with button edges, so that clicks and keys reach the receiver in the order they happened
+// forwarded_keys must already hold the state after the event
+static bool enqueue_key_event(const key_event_t *event) {
+    uint8_t *frame = message_queue_tail(MESSAGE_LANE_BUTTONS);
+    if (frame == NULL || frame_device_id(frame) != device_id_remote || frame_type(frame) != REPORT_FRAME_KEY || !encode_key_event(frame, link_capabilities.report_size, event, forwarded_keys)) {
+        frame = message_queue_push(MESSAGE_LANE_BUTTONS, device_id_remote);
+        if (frame == NULL) {
+            return false;
+        }
+        encode_key_frame(frame);
+        if (!encode_key_event(frame, link_capabilities.report_size, event, forwarded_keys)) {
+            return false;
+        }
+    }
+    last_key_frame_time = timer_read();
+    key_refreshes_left = KEY_REFRESHES_AFTER_RELEASE;
+    return true;
+}
+
+// forward a key event if the receiver asked for keys, returns false if the event shouldn't be processed locally
+// the release of a forwarded press is always forwarded, even if forwarding was turned off in between
+// releases are always processed locally, since blocking only applies to presses
+static bool forward_key_event(uint16_t keycode, keyrecord_t *record) {
+    if (state != MOUSE_PASSTHROUGH_REMOTE_CONNECTED || keycode == KC_NO) {
+        return true;
+    }
+    key_event_t event = {
+        .time = record->event.time,
+        .keycode = keycode,
+        .pressed = record->event.pressed,
+    };
+    if (!record->event.pressed) {
+        int8_t slot = forwarded_key_slot(keycode);
+        if (slot >= 0) {
+            // if the lane is full, the next refresh carries the release
+            forwarded_keys[slot] = KC_NO;
+            enqueue_key_event(&event);
+        }
+        return true;
+    }
+    if (!send_keys_on) {
+        return !block_keys_on;
+    }
+    int8_t slot = forwarded_key_slot(KC_NO);
+    if (slot < 0 || forwarded_key_slot(keycode) >= 0) {
+        return true;
+    }
+    forwarded_keys[slot] = keycode;
+    if (!enqueue_key_event(&event)) {
+        forwarded_keys[slot] = KC_NO;
+        return true;
+    }
+    return !block_keys_on;
+}
+
+// key frames can be lost like any data frame, so the held keys are sent again while any are held, and a few times after the last
+// release, which makes the receiver release keys whose release it missed (and press keys whose press it missed)
+static void key_refresh_task(void) {
+    if (state != MOUSE_PASSTHROUGH_REMOTE_CONNECTED || timer_elapsed(last_key_frame_time) < MOUSE_PASSTHROUGH_KEY_REFRESH_INTERVAL) {
+        return;
+    }
+    bool held = false;
+    for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS; i++) {
+        held = held || forwarded_keys[i] != KC_NO;
+    }
+    if (!held && key_refreshes_left == 0) {
+        return;
+    }
+    uint8_t *frame = message_queue_push(MESSAGE_LANE_BUTTONS, device_id_remote);
+    if (frame == NULL) {
+        return;
+    }
+    encode_key_frame(frame);
+    encode_held_keys(frame, forwarded_keys);
+    last_key_frame_time = timer_read();
+    if (!held) {
+        key_refreshes_left--;
+    }
+}
+
+// additive decrease, multiplicative increase of the send interval, so that the motion lane stays short and queued motion stays fresh
+// a lane that doesn't drain or a receiver that is low on credit both count as congestion
+static void update_send_interval(void) {
+    if (timer_elapsed(last_send_interval_change_time) < MOUSE_PASSTHROUGH_CONGESTION_HOLD_MS) {
+        return;
+    }
+    uint8_t depth = message_lanes[MESSAGE_LANE_MOTION].count;
+    bool receiver_congested = receiver_credit != MOUSE_PASSTHROUGH_CREDIT_NONE && receiver_credit <= MOUSE_PASSTHROUGH_LOW_CREDIT;
+    if (depth > MOUSE_PASSTHROUGH_CONGESTION_TARGET_DEPTH || receiver_congested) {
+        if (send_interval == MOUSE_PASSTHROUGH_MAX_SEND_INTERVAL) {
+            return;
+        }
+        uint16_t doubled = send_interval * 2;
+        send_interval = (doubled == 0) ? 1 : (doubled > MOUSE_PASSTHROUGH_MAX_SEND_INTERVAL) ? MOUSE_PASSTHROUGH_MAX_SEND_INTERVAL : doubled;
+    } else if (send_interval > 0) {
+        send_interval--;
+    } else {
+        return;
+    }
+    last_send_interval_change_time = timer_read();
+    if (send_interval > stats.max_send_interval_ms) {
+        stats.max_send_interval_ms = send_interval;
+    }
+}
+
+// motion is sent at the congestion controller's interval, or less often if the receiver only needs it that often
+static uint8_t motion_sample_interval(void) {
+    if (pointer_filter == MOUSE_PASSTHROUGH_POINTER_FILTER_DRAGSCROLL && pointer_filter_interval > send_interval) {
+        return pointer_filter_interval;
+    }
+    return send_interval;
+}
+
+// handshake step 1/4: mouse sends a handshake request to a device
+static bool send_handshake_request(uint8_t device_id) {
+    uint8_t *message = message_queue_push(MESSAGE_LANE_LINK, device_id);
+    if (message == NULL) {
+        return false;
+    }
+    write_handshake(message, 13);
+    stats.handshake_messages_sent++;
+    return true;
+}
 
 // ============================================================================
 // MODULE API
 // ============================================================================
 
+void keyboard_post_init_mouse_passthrough(void) {
+    transport_init();
+    peer_cache_load();
+}
+
+bool process_record_mouse_passthrough(uint16_t keycode, keyrecord_t *record) {
+#    ifdef CONSOLE_ENABLE
+    if (record->event.pressed && keycode == KC_MOUSE_PASSTHROUGH_STATS) {
+        mouse_passthrough_print_stats();
+        return false;
+    }
+#    endif
+    return forward_key_event(keycode, record);
+}
+
 void housekeeping_task_mouse_passthrough(void) {
 
+    ping_task(state == MOUSE_PASSTHROUGH_REMOTE_CONNECTED, device_id_remote, heartbeat_due());
+    key_refresh_task();
+
     // we can only send one raw hid message per matrix scan, anything after the first message gets garbled for some reason
-    if (message_queue_next_empty_offset != 0) {
-        message_queue_next_empty_offset -= QMK_RAW_HID_REPORT_SIZE;
-        raw_hid_send(message_queue + message_queue_next_empty_offset, QMK_RAW_HID_REPORT_SIZE);
+    message_queue_send_next();
+    transport_task();
+    update_send_interval();
+
+    if (reset_requested && message_lanes[MESSAGE_LANE_CONTROL].count == 0) {
+        reset_keyboard();
     }
 
-    if (timer_elapsed32(last_connection_success_time) > HUB_CONNECTION_EXPIRY_INTERVAL) {
+    if (state != MOUSE_PASSTHROUGH_DISCONNECTED && timer_elapsed32(last_connection_success_time) > HUB_CONNECTION_EXPIRY_INTERVAL) {
         state = MOUSE_PASSTHROUGH_DISCONNECTED;
+        device_list_valid = false;
+        connection_attempt_now();
     }
 
-    if (timer_elapsed32(last_connection_attempt_time) > HUB_CONNECTION_ATTEMPT_INTERVAL) {
-        last_connection_attempt_time = timer_read32();
+    if (state != MOUSE_PASSTHROUGH_REMOTE_CONNECTED && connection_attempt_due()) {
         // send a registration report
-        if (message_queue_next_empty_offset < sizeof(message_queue)) {
-            memset(message_queue + message_queue_next_empty_offset, 0, QMK_RAW_HID_REPORT_SIZE);
-            message_queue[message_queue_next_empty_offset + REPORT_OFFSET_COMMAND_ID] = RAW_HID_HUB_COMMAND_ID;
-            message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DEVICE_ID] = 0xFF;
-            message_queue[message_queue_next_empty_offset + REPORT_OFFSET_REGISTRATION] = 0x01;
-            message_queue_next_empty_offset += QMK_RAW_HID_REPORT_SIZE;
-        }
-        
-        if (state == MOUSE_PASSTHROUGH_HUB_CONNECTED) {
-            // handshake step 1/4: mouse broadcasts to all devices
-            for (int i = 0; i < MAX_REGISTERED_DEVICES - 1; i++) {
-                if (device_id_others[i] != DEVICE_ID_UNASSIGNED) {
-                    if (message_queue_next_empty_offset < sizeof(message_queue)) {
-                        memset(message_queue + message_queue_next_empty_offset, 0, QMK_RAW_HID_REPORT_SIZE);
-                        message_queue[message_queue_next_empty_offset + REPORT_OFFSET_COMMAND_ID] = RAW_HID_HUB_COMMAND_ID;
-                        message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DEVICE_ID] = device_id_others[i];
-                        message_queue[message_queue_next_empty_offset + REPORT_OFFSET_HANDSHAKE] = 13;
-                        message_queue_next_empty_offset += QMK_RAW_HID_REPORT_SIZE;
-                    }
-                }
-            }
+        uint8_t *message = message_queue_push(MESSAGE_LANE_LINK, DEVICE_ID_HUB);
+        if (message != NULL) {
+            encode_registration(message);
+        }
+        broadcast_remaining = MAX_REGISTERED_DEVICES - 1;
+    }
+
+    // broadcast to all devices, one per housekeeping pass so that the link lane always has room for handshake replies
+    while (state == MOUSE_PASSTHROUGH_HUB_CONNECTED && broadcast_remaining > 0) {
+        uint8_t device_id = device_id_others[broadcast_cursor];
+        if (device_id != DEVICE_ID_UNASSIGNED && !send_handshake_request(device_id)) {
+            break;
+        }
+        broadcast_cursor = (broadcast_cursor + 1) % (MAX_REGISTERED_DEVICES - 1);
+        broadcast_remaining--;
+        if (device_id != DEVICE_ID_UNASSIGNED) {
+            break;
         }
     }
 }
@@ -85,21 +949,46 @@ report_mouse_t pointing_device_task_mouse_passthrough(report_mouse_t mouse) {
     }
 
     // send data payload
-    if (((send_buttons_on && (mouse.buttons != last_buttons_sent)) || (send_pointer_on && ((mouse.x != 0) || (mouse.y != 0))) || (send_wheel_on && ((mouse.v != 0) || (mouse.h != 0)))) && (message_queue_next_empty_offset < sizeof(message_queue))) {
-        memset(message_queue + message_queue_next_empty_offset, 0, QMK_RAW_HID_REPORT_SIZE);
-        message_queue[message_queue_next_empty_offset + REPORT_OFFSET_COMMAND_ID] = RAW_HID_HUB_COMMAND_ID;
-        message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DEVICE_ID] = device_id_remote;
-        message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DATA_BUTTONS] = mouse.buttons;
-        message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DATA_X_MSB] = (mouse.x >> 8) & 0xFF;
-        message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DATA_X_LSB] = mouse.x & 0xFF;
-        message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DATA_Y_MSB] = (mouse.y >> 8) & 0xFF;
-        message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DATA_Y_LSB] = mouse.y & 0xFF;
-        message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DATA_V_MSB] = (mouse.v >> 8) & 0xFF;
-        message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DATA_V_LSB] = mouse.v & 0xFF;
-        message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DATA_H_MSB] = (mouse.h >> 8) & 0xFF;
-        message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DATA_H_LSB] = mouse.h & 0xFF;
-        message_queue_next_empty_offset += QMK_RAW_HID_REPORT_SIZE;
-        last_buttons_sent = mouse.buttons;
+    // samples are packed into the newest unsent frame, and button edges get their own lane so that they never wait behind motion,
+    // carrying the motion that was queued before them along with them
+    if (send_pointer_on) {
+        report_mouse_t pointer = mouse;
+#    ifdef MOUSE_PASSTHROUGH_AXIS_SNAPPING_FILTER
+        if (pointer_filter == MOUSE_PASSTHROUGH_POINTER_FILTER_AXIS_SNAPPING) {
+            pointer = mouse_axis_snapping_apply(&axis_snapping_filter, pointer);
+        }
+#    endif
+        pending_x += pointer.x;
+        pending_y += pointer.y;
+    }
+    if (send_wheel_on) {
+        pending_v += mouse.v;
+        pending_h += mouse.h;
+    }
+    bool button_edge = send_buttons_on && (mouse.buttons != last_buttons_sent);
+    if (button_edge) {
+        take_queued_motion();
+    }
+    const packed_sample_t empty_sample = {0};
+    packed_sample_t sample = empty_sample;
+    take_pending_motion(&sample);
+    if (button_edge) {
+        // button edges are never dropped, if the lane is full the edge is retried on the next pointing device task
+        sample.flags = PACKED_SAMPLE_BUTTONS;
+        sample.buttons = mouse.buttons;
+        if (enqueue_sample(MESSAGE_LANE_BUTTONS, &sample)) {
+            last_buttons_sent = mouse.buttons;
+            clear_pending_motion(&empty_sample, &sample);
+        }
+    } else if ((sample.x != 0 || sample.y != 0 || sample.v != 0 || sample.h != 0) && timer_elapsed(last_motion_sample_time) >= motion_sample_interval()) {
+        // under congestion, motion degrades to a lower rate instead of being lost
+        // the send interval keeps it pending here, and a full lane sums it into the last queued sample
+        if (enqueue_sample(MESSAGE_LANE_MOTION, &sample)) {
+            clear_pending_motion(&empty_sample, &sample);
+            last_motion_sample_time = timer_read();
+        } else {
+            coalesce_pending_motion();
+        }
     }
 
     // block inputs
@@ -129,23 +1018,39 @@ report_mouse_t pointing_device_task_mouse_passthrough(report_mouse_t mouse) {
     return mouse;
 }
 
-void raw_hid_receive(uint8_t* data, uint8_t length) {
+static void receive_message(uint8_t *data, uint8_t length) {
 
-    if (data[REPORT_OFFSET_COMMAND_ID] != RAW_HID_HUB_COMMAND_ID) {
+    // frames are only parsed up to the negotiated report size, so anything shorter than a whole report can't be trusted
+    if (length < QMK_RAW_HID_REPORT_SIZE || frame_command_id(data) != RAW_HID_HUB_COMMAND_ID) {
         return;
     }
 
+    stats.messages_received++;
     last_connection_success_time = timer_read32();
     if (state == MOUSE_PASSTHROUGH_DISCONNECTED) {
         state = MOUSE_PASSTHROUGH_HUB_CONNECTED;
     }
 
-    if (state == MOUSE_PASSTHROUGH_REMOTE_CONNECTED && data[REPORT_OFFSET_DEVICE_ID] == device_id_remote) {
-        // unpack control payload
-        if (data[REPORT_OFFSET_RESET] > 0) {
-            reset_keyboard();
+    if (state == MOUSE_PASSTHROUGH_REMOTE_CONNECTED && frame_device_id(data) == device_id_remote && handshake_step(data) != 26) {
+        if (process_ping_frame(data) || frame_type(data) != REPORT_FRAME_LEGACY) {
+            return;
         }
-        if (data[REPORT_OFFSET_CONTROL_BLOCK_BUTTONS] > 0) {
+
+        // unpack control payload, ignoring retransmissions that are older than what we already applied
+        control_frame_t control;
+        decode_control_payload(data, &control);
+        uint8_t sequence = control.sequence;
+        if (sequence != 0 && last_control_sequence != 0 && (int8_t)(sequence - last_control_sequence) < 0) {
+            return;
+        }
+        if (control.reset) {
+            // a sequenced reset waits for its acknowledgement to go out, so that the receiver doesn't keep retransmitting it
+            if (sequence == 0) {
+                reset_keyboard();
+            }
+            reset_requested = true;
+        }
+        if (control.block_buttons) {
             if (!block_buttons_on) {
                 if (last_buttons_received == 0) {
                     block_buttons_on = true;
@@ -157,7 +1062,7 @@ void raw_hid_receive(uint8_t* data, uint8_t length) {
             block_buttons_on = false;
             block_buttons_on_queued = false;
         }
-        if (data[REPORT_OFFSET_CONTROL_SEND_BUTTONS] == 0) {
+        if (!control.send_buttons) {
             if (send_buttons_on) {
                 if (last_buttons_received == 0) {
                     send_buttons_on = false;
@@ -171,53 +1076,114 @@ void raw_hid_receive(uint8_t* data, uint8_t length) {
 
             // TODO: do I want this?
             // // proactively send current buttons if necessary
-            // if ((last_buttons_received > 0) && (message_queue_next_empty_offset < sizeof(message_queue))) {
-            //     memset(message_queue + message_queue_next_empty_offset, 0, QMK_RAW_HID_REPORT_SIZE);
-            //     message_queue[message_queue_next_empty_offset + REPORT_OFFSET_COMMAND_ID] = RAW_HID_HUB_COMMAND_ID;
-            //     message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DEVICE_ID] = device_id_remote;
-            //     message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DATA_BUTTONS] = last_buttons_received; 
-            //     message_queue_next_empty_offset += QMK_RAW_HID_REPORT_SIZE;
-            //     last_buttons_sent = mouse.buttons;
+            // uint8_t *message = (last_buttons_received > 0) ? message_queue_push(MESSAGE_LANE_BUTTONS, device_id_remote) : NULL;
+            // if (message != NULL) {
+            //     encode_legacy_sample(message, &(packed_sample_t){.buttons = last_buttons_received});
+            //     last_buttons_sent = last_buttons_received;
             // }
 
         }
-        block_pointer_on = data[REPORT_OFFSET_CONTROL_BLOCK_POINTER];
-        block_wheel_on = data[REPORT_OFFSET_CONTROL_BLOCK_WHEEL];
-        send_pointer_on = data[REPORT_OFFSET_CONTROL_SEND_POINTER];
-        send_wheel_on = data[REPORT_OFFSET_CONTROL_SEND_WHEEL];
+        if (link_capabilities.features & CAPABILITY_FEATURE_CREDIT) {
+            receiver_credit = control.credit;
+        }
+        if (link_capabilities.features & CAPABILITY_FEATURE_POINTER_FILTER) {
+            if (control.pointer_filter != pointer_filter) {
+                pointer_filter = control.pointer_filter;
+#    ifdef MOUSE_PASSTHROUGH_AXIS_SNAPPING_FILTER
+                mouse_axis_snapping_reset(&axis_snapping_filter);
+#    endif
+            }
+            pointer_filter_interval = control.pointer_interval;
+        }
+        if (link_capabilities.features & CAPABILITY_FEATURE_KEYS) {
+            block_keys_on = control.block_keys;
+            send_keys_on = control.send_keys;
+        }
+        block_pointer_on = control.block_pointer;
+        block_wheel_on = control.block_wheel;
+        send_pointer_on = control.send_pointer;
+        send_wheel_on = control.send_wheel;
+
+        // acknowledge sequenced payloads with the state we applied, queued button changes count as applied
+        // a retransmission is acknowledged again, since it means that our acknowledgement got lost
+        if (sequence != 0) {
+            last_control_sequence = sequence;
+            uint8_t *message = message_queue_push(MESSAGE_LANE_CONTROL, device_id_remote);
+            if (message != NULL) {
+                control_frame_t ack = {
+                    .sequence = sequence,
+                    .block_buttons = block_buttons_on || block_buttons_on_queued,
+                    .block_pointer = block_pointer_on,
+                    .block_wheel = block_wheel_on,
+                    .send_buttons = send_buttons_on && !send_buttons_off_queued,
+                    .send_pointer = send_pointer_on,
+                    .send_wheel = send_wheel_on,
+                    .reset = reset_requested,
+                    .block_keys = block_keys_on,
+                    .send_keys = send_keys_on,
+                };
+                encode_control_ack(message, &ack);
+            }
+        }
 
-    } else if (data[REPORT_OFFSET_DEVICE_ID] == DEVICE_ID_HUB) {
-        if (data[REPORT_OFFSET_DEVICE_ID_SELF] == DEVICE_ID_UNASSIGNED) {
-            // hub has shutdown
+    } else if (frame_device_id(data) == DEVICE_ID_HUB) {
+        uint8_t device_id_listed;
+        const uint8_t *device_ids = decode_device_list(data, &device_id_listed);
+        if (device_id_listed == DEVICE_ID_UNASSIGNED) {
+            // hub has shutdown, register again as soon as it comes back
             state = MOUSE_PASSTHROUGH_DISCONNECTED;
+            device_list_valid = false;
+            connection_attempt_now();
         } else {
-            device_id_self = data[REPORT_OFFSET_DEVICE_ID_SELF];
-            memcpy(device_id_others, data + REPORT_OFFSET_DEVICE_ID_OTHERS, MAX_REGISTERED_DEVICES - 1);
-            if (state == MOUSE_PASSTHROUGH_REMOTE_CONNECTED) {
-                // see if we're still connected
-                bool found = false;
-                for (int i = REPORT_OFFSET_DEVICE_ID_OTHERS; i < QMK_RAW_HID_REPORT_SIZE; i++) {
-                    if (data[i] == device_id_remote) {
-                        found = true;
-                        break;
-                    }
+            if (device_list_valid && device_id_listed != device_id_self) {
+                // our id changed, so the hub restarted without us hearing about it and the remote's id is meaningless
+                device_list_valid = false;
+                device_id_remote = DEVICE_ID_UNASSIGNED;
+            }
+            if (state == MOUSE_PASSTHROUGH_REMOTE_CONNECTED && !device_list_contains(device_ids, device_id_remote)) {
+                // remote is gone, start handshaking again right away
+                state = MOUSE_PASSTHROUGH_HUB_CONNECTED;
+                connection_attempt_now();
+            }
+            if (state == MOUSE_PASSTHROUGH_HUB_CONNECTED && !device_list_valid) {
+                // first device list since connecting to the hub, handshake with the last paired keyboard directly and broadcast to the rest
+                if (peer_cache_is_current(0, device_id_listed, device_ids)) {
+                    send_handshake_request(peer_cache.entries[0].device_id);
                 }
-                if (!found) {
-                    state = MOUSE_PASSTHROUGH_HUB_CONNECTED;
+                broadcast_remaining = MAX_REGISTERED_DEVICES - 1;
+            } else if (state == MOUSE_PASSTHROUGH_HUB_CONNECTED) {
+                // devices that have just appeared on the hub get a handshake request right away instead of waiting for the next broadcast
+                for (uint8_t i = 0; i < MAX_REGISTERED_DEVICES - 1; i++) {
+                    if (device_ids[i] != DEVICE_ID_UNASSIGNED && !device_list_contains(device_id_others, device_ids[i])) {
+                        send_handshake_request(device_ids[i]);
+                    }
                 }
             }
+            device_id_self = device_id_listed;
+            memcpy(device_id_others, device_ids, MAX_REGISTERED_DEVICES - 1);
+            device_list_valid = true;
         }
-            
-    } else if (state == MOUSE_PASSTHROUGH_HUB_CONNECTED && data[REPORT_OFFSET_HANDSHAKE] == 26) {
+
+    } else if (handshake_step(data) == 26 && (state == MOUSE_PASSTHROUGH_HUB_CONNECTED || frame_device_id(data) == device_id_remote)) {
         // handshake step 3/4: mouse responds to first keyboard it hears from
-        if (message_queue_next_empty_offset < sizeof(message_queue)) {
+        // the current remote asks again if our response was lost or it restarted, which is answered without starting the link over
+        uint8_t *message = message_queue_push(MESSAGE_LANE_LINK, frame_device_id(data));
+        if (message != NULL) {
+            write_handshake(message, 39);
+            stats.handshake_messages_sent++;
+            link_capabilities = read_capabilities(data);
+            // the keyboard numbers its control payloads from scratch after a handshake
+            last_control_sequence = 0;
+        }
+        if (message != NULL && state == MOUSE_PASSTHROUGH_HUB_CONNECTED) {
             state = MOUSE_PASSTHROUGH_REMOTE_CONNECTED;
-            device_id_remote = data[REPORT_OFFSET_DEVICE_ID];
-            memset(message_queue + message_queue_next_empty_offset, 0, QMK_RAW_HID_REPORT_SIZE);
-            message_queue[message_queue_next_empty_offset + REPORT_OFFSET_COMMAND_ID] = RAW_HID_HUB_COMMAND_ID;
-            message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DEVICE_ID] = device_id_remote;
-            message_queue[message_queue_next_empty_offset + REPORT_OFFSET_HANDSHAKE] = 39;
-            message_queue_next_empty_offset += QMK_RAW_HID_REPORT_SIZE;
+            device_id_remote = frame_device_id(data);
+            peer_cache_store(device_id_remote, device_id_self);
+            stats.connections++;
+            pending_x = 0;
+            pending_y = 0;
+            pending_v = 0;
+            pending_h = 0;
             block_buttons_on = false;
             block_buttons_on_queued = false;
             block_pointer_on = false;
@@ -226,6 +1192,15 @@ void raw_hid_receive(uint8_t* data, uint8_t length) {
             send_buttons_off_queued = false;
             send_pointer_on = false;
             send_wheel_on = false;
+            block_keys_on = false;
+            send_keys_on = false;
+            for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS; i++) {
+                forwarded_keys[i] = KC_NO;
+            }
+            key_refreshes_left = 0;
+            send_interval = 0;
+            receiver_credit = MOUSE_PASSTHROUGH_CREDIT_NONE;
+            pointer_filter = MOUSE_PASSTHROUGH_POINTER_FILTER_NONE;
         }
     }
 }
@@ -246,141 +1221,724 @@ bool is_mouse_passthrough_connected(void) {
 // STATE
 // ============================================================================
 
+typedef struct control_state_t {
+    bool block_buttons_on;
+    bool block_pointer_on;
+    bool block_wheel_on;
+    bool send_buttons_on;
+    bool send_pointer_on;
+    bool send_wheel_on;
+    bool block_keys_on;
+    bool send_keys_on;
+    uint8_t pointer_filter;
+} control_state_t;
+
+// decoded mouse samples are handed from the receive path to the pointing device driver through a single-producer single-consumer ring,
+// so that the driver never reads a report that the receive path is halfway through updating, everything else the receive path
+// touches, key frames included, is only safe because raw hid messages are received from the main loop
+typedef struct ingress_sample_t {
+    uint8_t device_id;
+    bool timed;  // false for the older data frames, which carry no timestamp and skip the playout buffer
+    uint16_t sender_time;
+    uint16_t arrival_time;
+    packed_sample_t sample;
+} ingress_sample_t;
+
+#    if MOUSE_PASSTHROUGH_PLAYOUT_DELAY_MS > 0
+typedef struct playout_sample_t {
+    uint16_t due_time;
+    packed_sample_t sample;
+} playout_sample_t;
+#    endif
+
+// each connected sender gets its own slot, and the slot index is the device handle used by the user API
+typedef struct remote_device_t {
+    bool connected;  // false if the slot is free
+    uint8_t device_id;
+    link_capabilities_t capabilities;
+    control_state_t control;
+    bool control_state_changed;
+    bool reset_requested;
+    bool control_pending;  // waiting for the acknowledgement of control_sequence
+    uint8_t control_sequence;
+    uint8_t control_retries;
+    uint16_t last_control_send_time;
+    report_mouse_t accumulated_mouse_report;
+    uint16_t held_keys[MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS];  // forwarded keys that are pressed, KC_NO for free slots
+#    if MOUSE_PASSTHROUGH_PLAYOUT_DELAY_MS > 0
+    playout_sample_t playout_buffer[MOUSE_PASSTHROUGH_PLAYOUT_BUFFER_SIZE];
+    uint8_t playout_head;
+    uint8_t playout_count;
+    bool playout_credit_low;  // the sender has been told that its playout buffer is nearly full
+    // clock offset (receiver time - sender time) of the least delayed sample, tracked as a minimum over two windows
+    bool playout_offset_valid;
+    uint16_t playout_offset_current;
+    uint16_t playout_offset_previous;
+    uint16_t playout_window_start_time;
+#    endif
+    // set by the receive path when the sender is gone, the pointing device driver then releases its keys and clears the slot
+    // kept last, so that the slot can be cleared up to it and only handed back once it's entirely clear
+    bool release_pending;
+} remote_device_t;
+
 static uint8_t state = MOUSE_PASSTHROUGH_DISCONNECTED;
 static uint8_t device_id_self;
 static uint8_t device_id_others[MAX_REGISTERED_DEVICES - 1];
-static uint8_t device_id_remote;
-static uint32_t last_connection_attempt_time = 0;
-static uint32_t last_connection_success_time = 0;
-static uint8_t message_queue[QMK_RAW_HID_REPORT_SIZE * MAX_QUEUED_MESSAGES];
-static uint8_t message_queue_next_empty_offset = 0;
+static bool device_list_valid = false;  // device_id_others is only meaningful once the hub has sent a device list
+static uint32_t last_invitation_time = 0;
 
-static bool block_buttons_on = false;
-static bool block_pointer_on = false;
-static bool block_wheel_on = false;
-static bool send_buttons_on = false;
-static bool send_pointer_on = false;
-static bool send_wheel_on = false;
-static bool control_state_changed = false;
+static remote_device_t remote_devices[MOUSE_PASSTHROUGH_MAX_SENDERS];
+static control_state_t default_control = {0};  // applied to senders as they connect
+static uint8_t ping_cursor = 0;
+static ingress_sample_t ingress_ring[MOUSE_PASSTHROUGH_INGRESS_RING_SIZE];
+static uint8_t ingress_head = 0;  // only written by the pointing device driver
+static uint8_t ingress_tail = 0;  // only written by the receive path
+#    if MOUSE_PASSTHROUGH_IMMEDIATE_REPORT_INTERVAL > 0
+static uint16_t last_immediate_report_time = 0;
+#    endif
+
+// ============================================================================
+// INTERNAL FUNCTIONS
+// ============================================================================
+
+static void apply_sample(report_mouse_t *mouse_report, const packed_sample_t *sample) {
+    if (sample->flags & PACKED_SAMPLE_BUTTONS) {
+        mouse_report->buttons = sample->buttons;
+    }
+    mouse_report->x += sample->x;
+    mouse_report->y += sample->y;
+    mouse_report->v += sample->v;
+    mouse_report->h += sample->h;
+}
+
+#    if MOUSE_PASSTHROUGH_PLAYOUT_DELAY_MS > 0
+// a is earlier than b, with wraparound
+static bool time_before(uint16_t a, uint16_t b) {
+    return (int16_t)(a - b) < 0;
+}
+
+static void playout_update_offset(remote_device_t *device, uint16_t offset) {
+    uint16_t now = timer_read();
+    if (!device->playout_offset_valid) {
+        device->playout_offset_valid = true;
+        device->playout_offset_current = offset;
+        device->playout_offset_previous = offset;
+        device->playout_window_start_time = now;
+        return;
+    }
+    if (timer_elapsed(device->playout_window_start_time) > MOUSE_PASSTHROUGH_PLAYOUT_WINDOW_MS) {
+        // old minima expire so that the estimate follows clock drift
+        device->playout_offset_previous = device->playout_offset_current;
+        device->playout_offset_current = offset;
+        device->playout_window_start_time = now;
+    } else if (time_before(offset, device->playout_offset_current)) {
+        device->playout_offset_current = offset;
+    }
+}
+
+static uint16_t playout_offset(const remote_device_t *device) {
+    return time_before(device->playout_offset_previous, device->playout_offset_current) ? device->playout_offset_previous : device->playout_offset_current;
+}
+
+static void playout_push(remote_device_t *device, uint16_t sender_time, uint16_t arrival_time, const packed_sample_t *sample) {
+    playout_update_offset(device, arrival_time - sender_time);
+    if (device->playout_count == MOUSE_PASSTHROUGH_PLAYOUT_BUFFER_SIZE) {
+        // buffer is full, play the oldest sample early rather than lose it
+        apply_sample(&device->accumulated_mouse_report, &device->playout_buffer[device->playout_head].sample);
+        device->playout_head = (device->playout_head + 1) % MOUSE_PASSTHROUGH_PLAYOUT_BUFFER_SIZE;
+        device->playout_count--;
+    }
+    playout_sample_t *entry = &device->playout_buffer[(device->playout_head + device->playout_count) % MOUSE_PASSTHROUGH_PLAYOUT_BUFFER_SIZE];
+    entry->due_time = sender_time + playout_offset(device) + MOUSE_PASSTHROUGH_PLAYOUT_DELAY_MS;
+    entry->sample = *sample;
+    device->playout_count++;
+}
+
+// apply all samples that are due, but at most one button change per report so that clicks aren't merged
+static void playout_pop(remote_device_t *device, report_mouse_t *mouse_report) {
+    uint16_t now = timer_read();
+    bool buttons_changed = false;
+    while (device->playout_count > 0) {
+        playout_sample_t *entry = &device->playout_buffer[device->playout_head];
+        if (time_before(now, entry->due_time)) {
+            break;
+        }
+        if (entry->sample.flags & PACKED_SAMPLE_BUTTONS && entry->sample.buttons != mouse_report->buttons) {
+            if (buttons_changed) {
+                break;
+            }
+            buttons_changed = true;
+        }
+        apply_sample(mouse_report, &entry->sample);
+        device->playout_head = (device->playout_head + 1) % MOUSE_PASSTHROUGH_PLAYOUT_BUFFER_SIZE;
+        device->playout_count--;
+    }
+}
+
+// the free playout buffer space is sent along with control payloads, which go out as soon as it gets low or recovers
+static void update_playout_credit(remote_device_t *device) {
+    uint8_t free_slots = MOUSE_PASSTHROUGH_PLAYOUT_BUFFER_SIZE - device->playout_count;
+    bool credit_low = device->playout_credit_low ? (free_slots < MOUSE_PASSTHROUGH_LOW_CREDIT * 2) : (free_slots < MOUSE_PASSTHROUGH_LOW_CREDIT);
+    if (credit_low != device->playout_credit_low) {
+        device->playout_credit_low = credit_low;
+        device->control_state_changed = true;
+    }
+}
+
+static uint8_t playout_credit(const remote_device_t *device) {
+    uint16_t credit = MOUSE_PASSTHROUGH_PLAYOUT_BUFFER_SIZE - device->playout_count + 1;
+    return (credit > UINT8_MAX) ? UINT8_MAX : credit;
+}
+#    endif
+
+static remote_device_t *find_remote_device(uint8_t device_id) {
+    for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_SENDERS; i++) {
+        if (remote_devices[i].connected && remote_devices[i].device_id == device_id) {
+            return &remote_devices[i];
+        }
+    }
+    return NULL;
+}
+
+static remote_device_t *find_free_remote_device(void) {
+    for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_SENDERS; i++) {
+        if (!remote_devices[i].connected && !__atomic_load_n(&remote_devices[i].release_pending, __ATOMIC_ACQUIRE)) {
+            return &remote_devices[i];
+        }
+    }
+    return NULL;
+}
+
+// called from the receive path, wait-free: the sample is dropped if the ring is full
+static void ingress_push(uint8_t device_id, bool timed, uint16_t sender_time, const packed_sample_t *sample) {
+    uint8_t tail = ingress_tail;
+    if ((uint8_t)(tail - __atomic_load_n(&ingress_head, __ATOMIC_ACQUIRE)) == MOUSE_PASSTHROUGH_INGRESS_RING_SIZE) {
+        stats.ingress_overflows++;
+        return;
+    }
+    ingress_sample_t *entry = &ingress_ring[tail % MOUSE_PASSTHROUGH_INGRESS_RING_SIZE];
+    entry->device_id = device_id;
+    entry->timed = timed;
+    entry->sender_time = sender_time;
+    entry->arrival_time = timer_read();
+    entry->sample = *sample;
+    // the entry is only visible to the driver once it's complete
+    __atomic_store_n(&ingress_tail, (uint8_t)(tail + 1), __ATOMIC_RELEASE);
+}
+
+// called from the pointing device driver, wait-free: takes every sample published so far, and frees their slots in one step
+static void ingress_drain(void) {
+    uint8_t head = ingress_head;
+    uint8_t tail = __atomic_load_n(&ingress_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+        const ingress_sample_t *entry = &ingress_ring[head % MOUSE_PASSTHROUGH_INGRESS_RING_SIZE];
+        remote_device_t *device = find_remote_device(entry->device_id);
+        if (device == NULL) {
+            // the sender disconnected after the sample arrived
+            continue;
+        }
+#    if MOUSE_PASSTHROUGH_PLAYOUT_DELAY_MS > 0
+        if (entry->timed) {
+            playout_push(device, entry->sender_time, entry->arrival_time, &entry->sample);
+            continue;
+        }
+#    endif
+        apply_sample(&device->accumulated_mouse_report, &entry->sample);
+    }
+    __atomic_store_n(&ingress_head, tail, __ATOMIC_RELEASE);
+}
+
+#    if MOUSE_PASSTHROUGH_IMMEDIATE_REPORT_INTERVAL > 0
+static bool report_due(void) {
+    if (__atomic_load_n(&ingress_tail, __ATOMIC_ACQUIRE) != __atomic_load_n(&ingress_head, __ATOMIC_ACQUIRE)) {
+        return true;
+    }
+#        if MOUSE_PASSTHROUGH_PLAYOUT_DELAY_MS > 0
+    uint16_t now = timer_read();
+    for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_SENDERS; i++) {
+        const remote_device_t *device = &remote_devices[i];
+        if (device->connected && device->playout_count > 0 && !time_before(now, device->playout_buffer[device->playout_head].due_time)) {
+            return true;
+        }
+    }
+#        endif
+    return false;
+}
+
+// remote data that arrived after this scan's pointing device task doesn't wait for the next scan's, the report still goes
+// through QMK's whole pointing device task, so POINTING_DEVICE_TASK_THROTTLE_MS applies to it like to any other
+static void immediate_report_task(void) {
+    if (!report_due() || timer_elapsed(last_immediate_report_time) < MOUSE_PASSTHROUGH_IMMEDIATE_REPORT_INTERVAL) {
+        return;
+    }
+    last_immediate_report_time = timer_read();
+    pointing_device_task();
+}
+#    endif
+
+// forwarded key events are key events of their own, at a position in MOUSE_PASSTHROUGH_KEY_ROW that belongs to the
+// sender slot and held key slot, and they start at process_record, after combos and tap-hold have had their turn
+// records carry their keycode when COMBO_ENABLE or REPEAT_KEY_ENABLE is on, and then go through process_record like
+// a key in the keymap would, otherwise QMK would look the keycode up in the keymap, so the record goes through the
+// modules and the keyboard's process_record_kb, and basic keycodes (including consumer and system usages) that neither
+// handles are registered directly
+static void inject_key_event(const remote_device_t *device, uint8_t slot, uint16_t keycode, bool pressed, uint16_t time) {
+    keyrecord_t record = {
+        .event = {
+            .key = { .row = MOUSE_PASSTHROUGH_KEY_ROW, .col = (device - remote_devices) * MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS + slot },
+            .time = time,
+            .type = KEY_EVENT,
+            .pressed = pressed,
+        },
+    };
+#    if defined(COMBO_ENABLE) || defined(REPEAT_KEY_ENABLE)
+    record.keycode = keycode;
+    process_record(&record);
+#    else
+    if (process_record_modules(keycode, &record) && process_record_kb(keycode, &record) && keycode <= QK_MODS_MAX) {
+        if (pressed) {
+            register_code16(keycode);
+        } else {
+            unregister_code16(keycode);
+        }
+    }
+#    endif
+}
+
+// a sender timestamp on our clock, once the clock offset is known
+static uint16_t remote_event_time(const remote_device_t *device, uint16_t sender_time) {
+#    if MOUSE_PASSTHROUGH_PLAYOUT_DELAY_MS > 0
+    if (device->playout_offset_valid) {
+        return sender_time + playout_offset(device);
+    }
+#    else
+    (void)device;
+    (void)sender_time;
+#    endif
+    return timer_read();
+}
+
+// press or release a forwarded key, only presses that fit in held_keys and releases of held keys are injected,
+// so that every press gets exactly one release
+static bool is_key_held(const remote_device_t *device, uint16_t keycode) {
+    for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS; i++) {
+        if (device->held_keys[i] == keycode) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void update_held_key(remote_device_t *device, uint16_t keycode, bool pressed, uint16_t time) {
+    if (keycode == KC_NO || (pressed && is_key_held(device, keycode))) {
+        return;
+    }
+    uint8_t slot = 0;
+    uint16_t wanted = pressed ? KC_NO : keycode;
+    while (slot < MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS && device->held_keys[slot] != wanted) {
+        slot++;
+    }
+    if (slot == MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS) {
+        return;
+    }
+    device->held_keys[slot] = pressed ? keycode : KC_NO;
+    inject_key_event(device, slot, keycode, pressed, time);
+}
+
+// apply the events in a key frame, then catch up with the keys the sender holds, in case an earlier frame was lost
+static void unpack_key_frame(remote_device_t *device, const uint8_t *data) {
+    const key_frame_t *frame = (const key_frame_t *)data;
+    if (key_frame_length(data) > device->capabilities.report_size) {
+        // malformed frame
+        return;
+    }
+    for (uint8_t i = 0; i < frame->count; i++) {
+        key_event_t event;
+        decode_key_event(data, i, &event);
+        update_held_key(device, event.keycode, event.pressed, remote_event_time(device, event.time));
+    }
+    uint16_t now = timer_read();
+    for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS; i++) {
+        if (device->held_keys[i] != KC_NO && !key_frame_holds(data, device->held_keys[i])) {
+            update_held_key(device, device->held_keys[i], false, now);
+        }
+    }
+    for (uint8_t i = 0; i < frame->held_count; i++) {
+        update_held_key(device, decode_held_key(data, i), true, now);
+    }
+}
+
+// called from the receive path, which only lets go of the sender, since the pointing device driver may be using its slot
+static void release_remote_device(remote_device_t *device) {
+    device->connected = false;
+    __atomic_store_n(&device->release_pending, true, __ATOMIC_RELEASE);
+}
+
+// called from the pointing device driver: keys that released senders were holding down are released along with them,
+// and their slots are cleared before the receive path can reuse them
+static void clear_released_devices(void) {
+    for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_SENDERS; i++) {
+        remote_device_t *device = &remote_devices[i];
+        if (!__atomic_load_n(&device->release_pending, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        for (uint8_t slot = 0; slot < MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS; slot++) {
+            if (device->held_keys[slot] != KC_NO) {
+                inject_key_event(device, slot, device->held_keys[slot], false, timer_read());
+            }
+        }
+        memset(device, 0, offsetof(remote_device_t, release_pending));
+        __atomic_store_n(&device->release_pending, false, __ATOMIC_RELEASE);
+    }
+}
+
+static void update_connection_state(void) {
+    if (state == MOUSE_PASSTHROUGH_DISCONNECTED) {
+        return;
+    }
+    state = MOUSE_PASSTHROUGH_HUB_CONNECTED;
+    for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_SENDERS; i++) {
+        if (remote_devices[i].connected) {
+            state = MOUSE_PASSTHROUGH_REMOTE_CONNECTED;
+            return;
+        }
+    }
+}
+
+// lose the hub and all senders, and register again as soon as possible
+static void disconnect_all(void) {
+    state = MOUSE_PASSTHROUGH_DISCONNECTED;
+    device_list_valid = false;
+    for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_SENDERS; i++) {
+        if (remote_devices[i].connected) {
+            release_remote_device(&remote_devices[i]);
+        }
+    }
+    connection_attempt_now();
+}
+
+// handshake step 2/4: keyboard responds to a mouse
+static void send_handshake_response(uint8_t device_id) {
+    uint8_t *message = message_queue_push(MESSAGE_LANE_LINK, device_id);
+    if (message != NULL) {
+        write_handshake(message, 26);
+        stats.handshake_messages_sent++;
+    }
+}
+
+typedef enum control_component_t {
+    CONTROL_BUTTONS,
+    CONTROL_POINTER,
+    CONTROL_WHEEL,
+    CONTROL_KEYS,
+} control_component_t;
+
+static bool update_control_state(control_state_t *control, control_component_t component, bool send, bool block) {
+    bool *send_on;
+    bool *block_on;
+    switch (component) {
+        case CONTROL_BUTTONS:
+            send_on = &control->send_buttons_on;
+            block_on = &control->block_buttons_on;
+            break;
+        case CONTROL_POINTER:
+            send_on = &control->send_pointer_on;
+            block_on = &control->block_pointer_on;
+            break;
+        case CONTROL_WHEEL:
+            send_on = &control->send_wheel_on;
+            block_on = &control->block_wheel_on;
+            break;
+        default:
+            send_on = &control->send_keys_on;
+            block_on = &control->block_keys_on;
+            break;
+    }
+    if (*send_on == send && *block_on == block) {
+        return false;
+    }
+    *send_on = send;
+    *block_on = block;
+    return true;
+}
+
+static void set_control_state(uint8_t device, control_component_t component, bool send, bool block) {
+    if (device == MOUSE_PASSTHROUGH_ALL_DEVICES) {
+        update_control_state(&default_control, component, send, block);
+        for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_SENDERS; i++) {
+            if (remote_devices[i].connected && update_control_state(&remote_devices[i].control, component, send, block)) {
+                remote_devices[i].control_state_changed = true;
+            }
+        }
+    } else if (mouse_passthrough_is_device_connected(device)) {
+        if (update_control_state(&remote_devices[device].control, component, send, block)) {
+            remote_devices[device].control_state_changed = true;
+        }
+    }
+}
+
+// sequence numbers skip 0, which marks unsequenced control payloads
+static uint8_t next_control_sequence(uint8_t sequence) {
+    sequence++;
+    return sequence == 0 ? 1 : sequence;
+}
 
-static report_mouse_t accumulated_mouse_report = {0};
+// the control payload is acknowledged once the sender echoes the current sequence number with the state we asked for
+static void process_control_ack(remote_device_t *device, const uint8_t *data) {
+    const control_state_t *control = &device->control;
+    control_frame_t ack = {0};
+    decode_control_ack(data, &ack);
+    if (!device->control_pending || ack.sequence != device->control_sequence) {
+        return;
+    }
+    // senders that don't forward keys don't echo the key state
+    bool keys_match = !(device->capabilities.features & CAPABILITY_FEATURE_KEYS) || (ack.block_keys == control->block_keys_on && ack.send_keys == control->send_keys_on);
+    if (ack.block_buttons != control->block_buttons_on || ack.block_pointer != control->block_pointer_on || ack.block_wheel != control->block_wheel_on || ack.send_buttons != control->send_buttons_on || ack.send_pointer != control->send_pointer_on || ack.send_wheel != control->send_wheel_on || ack.reset != device->reset_requested || !keys_match) {
+        // the sender applied something else, send the state again as a new payload
+        device->control_state_changed = true;
+        return;
+    }
+    device->control_pending = false;
+}
+
+static void unpack_packed_payload(remote_device_t *device, const uint8_t *data) {
+    const packed_frame_t *frame = (const packed_frame_t *)data;
+    uint16_t sender_time = read_uint16(&frame->time);
+    uint8_t offset = 0;
+    for (uint8_t i = 0; i < frame->count; i++) {
+        uint8_t space = device->capabilities.report_size - sizeof(packed_frame_t);
+        if (offset >= space || offset + packed_sample_length(frame->samples[offset]) > space) {
+            // malformed frame, drop the rest of it
+            return;
+        }
+        packed_sample_t sample;
+        offset = decode_packed_sample(frame->samples, offset, &sample);
+        sender_time += sample.dt;
+        ingress_push(device->device_id, true, sender_time, &sample);
+    }
+}
 
 // ============================================================================
 // MODULE API
 // ============================================================================
 
+void keyboard_post_init_mouse_passthrough(void) {
+    transport_init();
+    peer_cache_load();
+}
+
 bool process_record_mouse_passthrough(uint16_t keycode, keyrecord_t *record) {
     if (record->event.pressed && keycode == KC_RESET_OTHER) {
         mouse_passthrough_send_reset_command();
         return false;
     }
+#    ifdef CONSOLE_ENABLE
+    if (record->event.pressed && keycode == KC_MOUSE_PASSTHROUGH_STATS) {
+        mouse_passthrough_print_stats();
+        return false;
+    }
+#    endif
     return true;
 }
 
 void housekeeping_task_mouse_passthrough(void) {
 
+    // ping the connected senders in turn
+    remote_device_t *ping_device = &remote_devices[ping_cursor];
+    if (ping_task(ping_device->connected, ping_device->device_id, heartbeat_due()) || !ping_device->connected) {
+        ping_cursor = (ping_cursor + 1) % MOUSE_PASSTHROUGH_MAX_SENDERS;
+    }
+
+    // send control payloads, and retransmit the ones that haven't been acknowledged
+    for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_SENDERS; i++) {
+        remote_device_t *device = &remote_devices[i];
+#    if MOUSE_PASSTHROUGH_PLAYOUT_DELAY_MS > 0
+        if (device->connected) {
+            update_playout_credit(device);
+        }
+#    endif
+        bool retransmit = device->control_pending && device->control_retries < MOUSE_PASSTHROUGH_CONTROL_MAX_RETRIES && timer_elapsed(device->last_control_send_time) > MOUSE_PASSTHROUGH_CONTROL_RETRY_INTERVAL;
+        if (!device->connected || !(device->control_state_changed || retransmit)) {
+            continue;
+        }
+        uint8_t *message = message_queue_push(MESSAGE_LANE_CONTROL, device->device_id);
+        if (message == NULL) {
+            break;
+        }
+        if (device->control_state_changed) {
+            device->control_sequence = next_control_sequence(device->control_sequence);
+            device->control_retries = 0;
+            // senders that don't acknowledge control payloads would only get them over and over
+            device->control_pending = device->capabilities.features & CAPABILITY_FEATURE_CONTROL_ACK;
+            device->control_state_changed = false;
+        } else {
+            device->control_retries++;
+            stats.control_retransmits++;
+        }
+        device->last_control_send_time = timer_read();
+        control_frame_t control = {
+            .sequence = device->control_sequence,
+            .block_buttons = device->control.block_buttons_on,
+            .block_pointer = device->control.block_pointer_on,
+            .block_wheel = device->control.block_wheel_on,
+            .send_buttons = device->control.send_buttons_on,
+            .send_pointer = device->control.send_pointer_on,
+            .send_wheel = device->control.send_wheel_on,
+            .reset = device->reset_requested,
+            .block_keys = device->control.block_keys_on,
+            .send_keys = device->control.send_keys_on,
+            .credit = MOUSE_PASSTHROUGH_CREDIT_NONE,
+            .pointer_filter = device->control.pointer_filter,
+            .pointer_interval = MOUSE_PASSTHROUGH_DRAGSCROLL_INTERVAL,
+        };
+#    if MOUSE_PASSTHROUGH_PLAYOUT_DELAY_MS > 0
+        control.credit = playout_credit(device);
+#    endif
+        encode_control_payload(message, &control);
+    }
+
     // we can only send one raw hid message per matrix scan, anything after the first message gets garbled for some reason
-    if (message_queue_next_empty_offset != 0) {
-        message_queue_next_empty_offset -= QMK_RAW_HID_REPORT_SIZE;
-        raw_hid_send(message_queue + message_queue_next_empty_offset, QMK_RAW_HID_REPORT_SIZE);
-    } else if (control_state_changed) {
-        // send control payload
-        memset(message_queue, 0, QMK_RAW_HID_REPORT_SIZE);
-        message_queue[REPORT_OFFSET_COMMAND_ID] = RAW_HID_HUB_COMMAND_ID;
-        message_queue[REPORT_OFFSET_DEVICE_ID] = device_id_remote;
-        message_queue[REPORT_OFFSET_CONTROL_BLOCK_BUTTONS] = block_buttons_on ? 1 : 0;
-        message_queue[REPORT_OFFSET_CONTROL_BLOCK_POINTER] = block_pointer_on ? 1 : 0;
-        message_queue[REPORT_OFFSET_CONTROL_BLOCK_WHEEL] = block_wheel_on ? 1 : 0;
-        message_queue[REPORT_OFFSET_CONTROL_SEND_BUTTONS] = send_buttons_on ? 1 : 0;
-        message_queue[REPORT_OFFSET_CONTROL_SEND_POINTER] = send_pointer_on ? 1 : 0;
-        message_queue[REPORT_OFFSET_CONTROL_SEND_WHEEL] = send_wheel_on ? 1 : 0;
-        raw_hid_send(message_queue, QMK_RAW_HID_REPORT_SIZE);
-        control_state_changed = false;
-    }
-
-    if (timer_elapsed32(last_connection_success_time) > HUB_CONNECTION_EXPIRY_INTERVAL) {
-        state = MOUSE_PASSTHROUGH_DISCONNECTED;
-        memset(&accumulated_mouse_report, 0, sizeof(accumulated_mouse_report));
+    message_queue_send_next();
+    transport_task();
+
+#    if MOUSE_PASSTHROUGH_IMMEDIATE_REPORT_INTERVAL > 0
+    // data that arrived since the last report, and playout samples that have come due
+    immediate_report_task();
+#    endif
+
+    if (state != MOUSE_PASSTHROUGH_DISCONNECTED && timer_elapsed32(last_connection_success_time) > HUB_CONNECTION_EXPIRY_INTERVAL) {
+        disconnect_all();
     }
 
-    if (timer_elapsed32(last_connection_attempt_time) > HUB_CONNECTION_ATTEMPT_INTERVAL) {
-        last_connection_attempt_time = timer_read32();
+    if (state != MOUSE_PASSTHROUGH_REMOTE_CONNECTED && connection_attempt_due()) {
         // send a registration report
-        if (message_queue_next_empty_offset < sizeof(message_queue)) {
-            memset(message_queue + message_queue_next_empty_offset, 0, QMK_RAW_HID_REPORT_SIZE);
-            message_queue[message_queue_next_empty_offset + REPORT_OFFSET_COMMAND_ID] = RAW_HID_HUB_COMMAND_ID;
-            message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DEVICE_ID] = DEVICE_ID_HUB;
-            message_queue[message_queue_next_empty_offset + REPORT_OFFSET_REGISTRATION] = 0x01;
-            message_queue_next_empty_offset += QMK_RAW_HID_REPORT_SIZE;
+        uint8_t *message = message_queue_push(MESSAGE_LANE_LINK, DEVICE_ID_HUB);
+        if (message != NULL) {
+            encode_registration(message);
         }
     }
 }
 
-void raw_hid_receive(uint8_t* data, uint8_t length) {
+static void receive_message(uint8_t *data, uint8_t length) {
 
-    if (data[REPORT_OFFSET_COMMAND_ID] != RAW_HID_HUB_COMMAND_ID) {
+    // frames are only parsed up to the negotiated report size, so anything shorter than a whole report can't be trusted
+    if (length < QMK_RAW_HID_REPORT_SIZE || frame_command_id(data) != RAW_HID_HUB_COMMAND_ID) {
         return;
     }
 
+    stats.messages_received++;
     last_connection_success_time = timer_read32();
     if (state == MOUSE_PASSTHROUGH_DISCONNECTED) {
         state = MOUSE_PASSTHROUGH_HUB_CONNECTED;
     }
 
-    if (state == MOUSE_PASSTHROUGH_REMOTE_CONNECTED && data[REPORT_OFFSET_DEVICE_ID] == device_id_remote) {
+    // a connected sender only handshakes again if it restarted or lost our handshake response
+    uint8_t device_id = frame_device_id(data);
+    bool handshake = handshake_step(data) == 13 || handshake_step(data) == 39;
+    remote_device_t *device = (device_id == DEVICE_ID_HUB) ? NULL : find_remote_device(device_id);
+    if (device != NULL && !handshake) {
         // unpack data payload
-        accumulated_mouse_report.buttons = data[REPORT_OFFSET_DATA_BUTTONS];
-        accumulated_mouse_report.x += ((uint16_t)data[REPORT_OFFSET_DATA_X_MSB] << 8) | ((uint16_t)data[REPORT_OFFSET_DATA_X_LSB]);
-        accumulated_mouse_report.y += ((uint16_t)data[REPORT_OFFSET_DATA_Y_MSB] << 8) | ((uint16_t)data[REPORT_OFFSET_DATA_Y_LSB]);
-        accumulated_mouse_report.v += ((uint16_t)data[REPORT_OFFSET_DATA_V_MSB] << 8) | ((uint16_t)data[REPORT_OFFSET_DATA_V_LSB]);
-        accumulated_mouse_report.h += ((uint16_t)data[REPORT_OFFSET_DATA_H_MSB] << 8) | ((uint16_t)data[REPORT_OFFSET_DATA_H_LSB]);
-
-    } else if (data[REPORT_OFFSET_DEVICE_ID] == DEVICE_ID_HUB) {
-        if (data[REPORT_OFFSET_DEVICE_ID_SELF] == DEVICE_ID_UNASSIGNED) {
+        if (process_ping_frame(data)) {
+            // ping or pong, not data
+        } else if (frame_type(data) == REPORT_FRAME_CONTROL_ACK) {
+            process_control_ack(device, data);
+        } else if (frame_type(data) == REPORT_FRAME_PACKED) {
+            unpack_packed_payload(device, data);
+        } else if (frame_type(data) == REPORT_FRAME_KEY) {
+            unpack_key_frame(device, data);
+        } else {
+            packed_sample_t sample;
+            decode_legacy_sample(data, &sample);
+            ingress_push(device->device_id, false, 0, &sample);
+        }
+
+    } else if (device_id == DEVICE_ID_HUB) {
+        uint8_t device_id_listed;
+        const uint8_t *device_ids = decode_device_list(data, &device_id_listed);
+        if (device_id_listed == DEVICE_ID_UNASSIGNED) {
             // hub has shutdown
-            state = MOUSE_PASSTHROUGH_DISCONNECTED;
-            memset(&accumulated_mouse_report, 0, sizeof(accumulated_mouse_report));
+            disconnect_all();
         } else {
-            device_id_self = data[REPORT_OFFSET_DEVICE_ID_SELF];
-            memcpy(device_id_others, data + REPORT_OFFSET_DEVICE_ID_OTHERS, MAX_REGISTERED_DEVICES - 1);
-            if (state == MOUSE_PASSTHROUGH_REMOTE_CONNECTED) {
-                // see if we're still connected
-                bool found = false;
-                for (int i = REPORT_OFFSET_DEVICE_ID_OTHERS; i < QMK_RAW_HID_REPORT_SIZE; i++) {
-                    if (data[i] == device_id_remote) {
-                        found = true;
-                        break;
-                    }
+            // if our id changed, the hub restarted without us hearing about it and all sender ids are meaningless
+            bool hub_restarted = device_list_valid && device_id_listed != device_id_self;
+            if (hub_restarted) {
+                device_list_valid = false;
+            }
+            // release senders that are no longer registered with the hub
+            for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_SENDERS; i++) {
+                if (remote_devices[i].connected && (hub_restarted || !device_list_contains(device_ids, remote_devices[i].device_id))) {
+                    release_remote_device(&remote_devices[i]);
                 }
-                if (!found) {
-                    state = MOUSE_PASSTHROUGH_HUB_CONNECTED;
-                    memset(&accumulated_mouse_report, 0, sizeof(accumulated_mouse_report));
+            }
+            update_connection_state();
+            // respond right away to previously paired mice that have just appeared on the hub, without waiting for their broadcast
+            for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_PEER_CACHE_SIZE; i++) {
+                uint8_t peer_id = peer_cache.entries[i].device_id;
+                if (peer_cache_is_current(i, device_id_listed, device_ids) && find_remote_device(peer_id) == NULL && !(device_list_valid && device_list_contains(device_id_others, peer_id))) {
+                    send_handshake_response(peer_id);
                 }
             }
+            device_id_self = device_id_listed;
+            memcpy(device_id_others, device_ids, MAX_REGISTERED_DEVICES - 1);
+            device_list_valid = true;
         }
-        
-    } else if (state == MOUSE_PASSTHROUGH_HUB_CONNECTED && data[REPORT_OFFSET_HANDSHAKE] == 13) {
-        // handshake step 2/4: all capable keyboards respond to mouse
-        if (message_queue_next_empty_offset < sizeof(message_queue)) {
-            device_id_remote = data[REPORT_OFFSET_DEVICE_ID];
-            memset(message_queue + message_queue_next_empty_offset, 0, QMK_RAW_HID_REPORT_SIZE);
-            message_queue[message_queue_next_empty_offset + REPORT_OFFSET_COMMAND_ID] = RAW_HID_HUB_COMMAND_ID;
-            message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DEVICE_ID] = device_id_remote;
-            message_queue[message_queue_next_empty_offset + REPORT_OFFSET_HANDSHAKE] = 26;
-            message_queue_next_empty_offset += QMK_RAW_HID_REPORT_SIZE;
+
+    } else if (handshake_step(data) == 13) {
+        // all capable keyboards respond to mouse, a connected mouse that broadcasts has restarted
+        if (device != NULL) {
+            release_remote_device(device);
+            update_connection_state();
+        }
+        send_handshake_response(device_id);
+
+    } else if (handshake_step(data) == 39 && device != NULL) {
+        // repeated mouse response, make sure the mouse has our control state
+        device->capabilities = read_capabilities(data);
+        device->control_state_changed = true;
+
+    } else if (handshake_step(data) == 39) {
+        // handshake step 4/4: keyboard silently receives mouse response, and gives the mouse a free slot
+        device = find_free_remote_device();
+        if (device != NULL) {
+            peer_cache_store(device_id, device_id_self);
+            device->connected = true;
+            device->device_id = device_id;
+            device->capabilities = read_capabilities(data);
+            device->control = default_control;
+            device->control_state_changed = true;
+            state = MOUSE_PASSTHROUGH_REMOTE_CONNECTED;
+            stats.connections++;
         }
 
-    } else if (state == MOUSE_PASSTHROUGH_HUB_CONNECTED && data[REPORT_OFFSET_DEVICE_ID] == device_id_remote && data[REPORT_OFFSET_HANDSHAKE] == 39) {
-        // handshake step 4/4: keyboard silently receives mouse response
-        state = MOUSE_PASSTHROUGH_REMOTE_CONNECTED;
-        device_id_remote = data[REPORT_OFFSET_DEVICE_ID];
+    } else if (find_free_remote_device() != NULL && timer_elapsed32(last_invitation_time) > HUB_CONNECTION_RETRY_INTERVAL) {
+        // a mouse that sends us anything else believes it's paired with us, but we restarted or its last handshake message was lost
+        last_invitation_time = timer_read32();
+        send_handshake_response(device_id);
     }
 }
 
+// senders are merged into one report: buttons are ORed together and motion is summed
 report_mouse_t pointing_device_driver_get_report(report_mouse_t mouse_report) {
-    memcpy(&mouse_report, &accumulated_mouse_report, sizeof(accumulated_mouse_report));
-    memset(&accumulated_mouse_report, 0, sizeof(accumulated_mouse_report));
-    accumulated_mouse_report.buttons = mouse_report.buttons;
+    memset(&mouse_report, 0, sizeof(mouse_report));
+    clear_released_devices();
+    ingress_drain();
+    for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_SENDERS; i++) {
+        remote_device_t *device = &remote_devices[i];
+        if (!device->connected) {
+            continue;
+        }
+        report_mouse_t device_report = device->accumulated_mouse_report;
+#    if MOUSE_PASSTHROUGH_PLAYOUT_DELAY_MS > 0
+        playout_pop(device, &device_report);
+#    endif
+        memset(&device->accumulated_mouse_report, 0, sizeof(device->accumulated_mouse_report));
+        device->accumulated_mouse_report.buttons = device_report.buttons;
+        mouse_report.buttons |= device_report.buttons;
+        mouse_report.x += device_report.x;
+        mouse_report.y += device_report.y;
+        mouse_report.v += device_report.v;
+        mouse_report.h += device_report.h;
+    }
 #    ifdef POINTING_DEVICE_HIRES_SCROLL_ENABLE
     mouse_report.h *= pointing_device_get_hires_scroll_resolution();
     mouse_report.v *= pointing_device_get_hires_scroll_resolution();
@@ -397,39 +1955,76 @@ bool is_mouse_passthrough_connected(void) {
     return state == MOUSE_PASSTHROUGH_REMOTE_CONNECTED;
 }
 
-void mouse_passthrough_set_buttons_state(bool send, bool block) {
-    if (send_buttons_on != send || block_buttons_on != block) {
-        send_buttons_on = send;
-        block_buttons_on = block;
-        control_state_changed = true;
-    }
+bool mouse_passthrough_is_device_connected(uint8_t device) {
+    return device < MOUSE_PASSTHROUGH_MAX_SENDERS && remote_devices[device].connected;
 }
 
-void mouse_passthrough_set_pointer_state(bool send, bool block) {
-    if (send_pointer_on != send || block_pointer_on != block) {
-        send_pointer_on = send;
-        block_pointer_on = block;
-        control_state_changed = true;
-    }
+void mouse_passthrough_set_buttons_state(uint8_t device, bool send, bool block) {
+    set_control_state(device, CONTROL_BUTTONS, send, block);
+}
+
+void mouse_passthrough_set_pointer_state(uint8_t device, bool send, bool block) {
+    set_control_state(device, CONTROL_POINTER, send, block);
 }
 
-void mouse_passthrough_set_wheel_state(bool send, bool block) {
-    if (send_wheel_on != send || block_wheel_on != block) {
-        send_wheel_on = send;
-        block_wheel_on = block;
-        control_state_changed = true;
+void mouse_passthrough_set_wheel_state(uint8_t device, bool send, bool block) {
+    set_control_state(device, CONTROL_WHEEL, send, block);
+}
+
+void mouse_passthrough_set_keys_state(uint8_t device, bool send, bool block) {
+    set_control_state(device, CONTROL_KEYS, send, block);
+}
+
+void mouse_passthrough_set_pointer_filter(uint8_t device, mouse_passthrough_pointer_filter_t filter) {
+    if (device == MOUSE_PASSTHROUGH_ALL_DEVICES) {
+        default_control.pointer_filter = filter;
+        for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_SENDERS; i++) {
+            if (remote_devices[i].connected && remote_devices[i].control.pointer_filter != filter) {
+                remote_devices[i].control.pointer_filter = filter;
+                remote_devices[i].control_state_changed = true;
+            }
+        }
+    } else if (mouse_passthrough_is_device_connected(device) && remote_devices[device].control.pointer_filter != filter) {
+        remote_devices[device].control.pointer_filter = filter;
+        remote_devices[device].control_state_changed = true;
     }
 }
 
 void mouse_passthrough_send_reset_command(void) {
-    // send a registration report
-    if (message_queue_next_empty_offset < sizeof(message_queue)) {
-        memset(message_queue + message_queue_next_empty_offset, 0, QMK_RAW_HID_REPORT_SIZE);
-        message_queue[message_queue_next_empty_offset + REPORT_OFFSET_COMMAND_ID] = RAW_HID_HUB_COMMAND_ID;
-        message_queue[message_queue_next_empty_offset + REPORT_OFFSET_DEVICE_ID] = device_id_remote;
-        message_queue[message_queue_next_empty_offset + REPORT_OFFSET_RESET] = 0x01;
-        message_queue_next_empty_offset += QMK_RAW_HID_REPORT_SIZE;
+    // the reset command goes out with the next control payload to every connected sender, and is retransmitted like one
+    for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_SENDERS; i++) {
+        if (remote_devices[i].connected) {
+            remote_devices[i].reset_requested = true;
+            remote_devices[i].control_state_changed = true;
+        }
     }
 }
 
-#endif  // MOUSE_PASSTHROUGH_RECEIVER
\ No newline at end of file
+#endif  // MOUSE_PASSTHROUGH_RECEIVER
+
+// ============================================================================
+// STATISTICS API
+// ============================================================================
+
+void mouse_passthrough_get_stats(mouse_passthrough_stats_t *out) {
+    stats.rtt_p50_ms = rtt_percentile(50);
+    stats.rtt_p99_ms = rtt_percentile(99);
+    memcpy(out, &stats, sizeof(stats));
+}
+
+void mouse_passthrough_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+    memset(rtt_histogram, 0, sizeof(rtt_histogram));
+}
+
+#ifdef CONSOLE_ENABLE
+void mouse_passthrough_print_stats(void) {
+    mouse_passthrough_stats_t current;
+    mouse_passthrough_get_stats(&current);
+    uint16_t lost = current.pings_sent > current.pongs_received ? current.pings_sent - current.pongs_received : 0;
+    uprintf("mouse passthrough: sent %lu, received %lu, queue full %lu, coalesced %lu, max depth %u\n", (unsigned long)current.messages_sent, (unsigned long)current.messages_received, (unsigned long)current.queue_full, (unsigned long)current.coalesced, current.max_queue_depth);
+    uprintf("mouse passthrough: handshake messages %u, connections %u, control retransmits %u, max send interval %u ms, ingress overflows %u\n", current.handshake_messages_sent, current.connections, current.control_retransmits, current.max_send_interval_ms, current.ingress_overflows);
+    uprintf("mouse passthrough: pings %u, pongs %u, lost %u, rtt last %u ms, p50 %u ms, p99 %u ms\n", current.pings_sent, current.pongs_received, lost, current.rtt_last_ms, current.rtt_p50_ms, current.rtt_p99_ms);
+    uprintf("mouse passthrough: remote sent %u, received %u, queue full %u, coalesced %u, max depth %u\n", current.remote_messages_sent, current.remote_messages_received, current.remote_queue_full, current.remote_coalesced, current.remote_max_queue_depth);
+}
+#endif
@@ -43,16 +43,189 @@ enum report_structure_mouse_passthrough {
     REPORT_OFFSET_CONTROL_SEND_POINTER,
     REPORT_OFFSET_CONTROL_SEND_WHEEL,
     REPORT_OFFSET_RESET,
+    REPORT_OFFSET_CONTROL_SEQUENCE,
+    REPORT_OFFSET_CONTROL_CREDIT,
+    REPORT_OFFSET_CONTROL_POINTER_FILTER,
+    REPORT_OFFSET_CONTROL_POINTER_INTERVAL,
+    REPORT_OFFSET_CONTROL_BLOCK_KEYS,
+    REPORT_OFFSET_CONTROL_SEND_KEYS,
 };
 
+// handshake messages after the request carry the capabilities of the device that sends them, devices that predate them send zeros
+// and are treated as protocol version 0: MOUSE_PASSTHROUGH_LEGACY_REPORT_SIZE byte reports, legacy data frames only, no optional features
+enum report_structure_capabilities {
+    REPORT_OFFSET_CAPABILITY_VERSION = 3,
+    REPORT_OFFSET_CAPABILITY_REPORT_SIZE,
+    REPORT_OFFSET_CAPABILITY_FRAME_FORMATS,
+    REPORT_OFFSET_CAPABILITY_FEATURES,
+};
+
+#define MOUSE_PASSTHROUGH_PROTOCOL_VERSION 1
+#define MOUSE_PASSTHROUGH_LEGACY_REPORT_SIZE 32
+
+enum capability_frame_formats {
+    CAPABILITY_FRAME_LEGACY = (1 << 0),
+    CAPABILITY_FRAME_PACKED = (1 << 1),
+};
+
+enum capability_features {
+    CAPABILITY_FEATURE_CONTROL_ACK = (1 << 0),     // control payloads are acknowledged, so the receiver can retransmit them
+    CAPABILITY_FEATURE_CREDIT = (1 << 1),          // control payloads carry the receiver's playout credit
+    CAPABILITY_FEATURE_POINTER_FILTER = (1 << 2),  // control payloads carry a pointer filter
+    CAPABILITY_FEATURE_KEYS = (1 << 3),            // key events are forwarded in key frames
+};
+
+// filters that the sender runs on pointer motion before sending it, so that the receiver doesn't get motion it would throw away
+// senders that predate them ignore the filter, which only costs bandwidth since the receiver runs its own filters anyway
+typedef enum mouse_passthrough_pointer_filter_t {
+    MOUSE_PASSTHROUGH_POINTER_FILTER_NONE = 0,
+    MOUSE_PASSTHROUGH_POINTER_FILTER_AXIS_SNAPPING,  // only motion along the snapped axis is sent, as mouse_axis_snapping would pass it
+    MOUSE_PASSTHROUGH_POINTER_FILTER_DRAGSCROLL,     // motion is summed and sent at the interval in the control payload, for hires_dragscroll
+} mouse_passthrough_pointer_filter_t;
+
+// the credit in control payloads is the receiver's free playout buffer space in samples plus one, 0 if it doesn't report any
+#define MOUSE_PASSTHROUGH_CREDIT_NONE 0
+
+// packed data frames carry several delta-encoded samples in one report, after the sender timestamp (ms) of the first sample
+// each sample starts with a flags byte, followed by the fields it announces:
+// the time since the previous sample (only when it doesn't fit in the flags byte), the button byte (only when it changes),
+// then x/y, then v/h, each as an 8-bit or 16-bit big endian pair
+enum report_frame_types {
+    REPORT_FRAME_LEGACY = 0,
+    REPORT_FRAME_PACKED = 0x40,
+};
+
+enum report_structure_packed {
+    REPORT_OFFSET_FRAME_TYPE = 2,
+    REPORT_OFFSET_PACKED_COUNT,
+    REPORT_OFFSET_PACKED_TIME_MSB,
+    REPORT_OFFSET_PACKED_TIME_LSB,
+    REPORT_OFFSET_PACKED_SAMPLES,
+};
+
+enum packed_sample_flags {
+    PACKED_SAMPLE_BUTTONS = (1 << 0),
+    PACKED_SAMPLE_XY8 = (1 << 1),
+    PACKED_SAMPLE_XY16 = (1 << 2),
+    PACKED_SAMPLE_VH8 = (1 << 3),
+    PACKED_SAMPLE_VH16 = (1 << 4),
+    PACKED_SAMPLE_DT_MASK = (3 << 5),
+};
+
+#define PACKED_SAMPLE_DT_SHIFT 5
+#define PACKED_SAMPLE_DT_ESCAPE 3
+#define PACKED_SAMPLE_MAX_LENGTH 11
+
+// ping frames are answered by pong frames that echo the ping timestamp and carry the responder's counters (lower 16 bits)
+enum report_frame_types_link {
+    REPORT_FRAME_PING = 0x41,
+    REPORT_FRAME_PONG = 0x42,
+};
+
+enum report_structure_ping {
+    REPORT_OFFSET_PING_TIME_MSB = 3,
+    REPORT_OFFSET_PING_TIME_LSB,
+    REPORT_OFFSET_PONG_MESSAGES_SENT_MSB,
+    REPORT_OFFSET_PONG_MESSAGES_SENT_LSB,
+    REPORT_OFFSET_PONG_MESSAGES_RECEIVED_MSB,
+    REPORT_OFFSET_PONG_MESSAGES_RECEIVED_LSB,
+    REPORT_OFFSET_PONG_QUEUE_FULL_MSB,
+    REPORT_OFFSET_PONG_QUEUE_FULL_LSB,
+    REPORT_OFFSET_PONG_COALESCED_MSB,
+    REPORT_OFFSET_PONG_COALESCED_LSB,
+    REPORT_OFFSET_PONG_MAX_QUEUE_DEPTH,
+};
+
+// control payloads carry a sequence number in byte 19, right after the reset flag in byte 18 (0 for receivers that predate it),
+// which the sender acknowledges with the block/send state it applied, so that the receiver can retransmit lost control payloads and reset commands
+enum report_frame_types_control {
+    REPORT_FRAME_CONTROL_ACK = 0x43,
+};
+
+enum report_structure_control_ack {
+    REPORT_OFFSET_CONTROL_ACK_SEQUENCE = 3,
+    REPORT_OFFSET_CONTROL_ACK_BLOCK_BUTTONS,
+    REPORT_OFFSET_CONTROL_ACK_BLOCK_POINTER,
+    REPORT_OFFSET_CONTROL_ACK_BLOCK_WHEEL,
+    REPORT_OFFSET_CONTROL_ACK_SEND_BUTTONS,
+    REPORT_OFFSET_CONTROL_ACK_SEND_POINTER,
+    REPORT_OFFSET_CONTROL_ACK_SEND_WHEEL,
+    REPORT_OFFSET_CONTROL_ACK_RESET,
+    REPORT_OFFSET_CONTROL_ACK_BLOCK_KEYS,
+    REPORT_OFFSET_CONTROL_ACK_SEND_KEYS,
+};
+
+// key frames forward the sender's key events, as keycodes from its keymap (including consumer and system usages), to the receiver
+// each event carries the sender timestamp (ms) of the event, the keycode, and whether the key was pressed or released
+// the events are followed by the keycodes that are still held after them (2 bytes each), which lets the receiver recover from lost frames
+enum report_frame_types_key {
+    REPORT_FRAME_KEY = 0x44,
+};
+
+enum report_structure_key {
+    REPORT_OFFSET_KEY_COUNT = 3,
+    REPORT_OFFSET_KEY_HELD_COUNT,
+    REPORT_OFFSET_KEY_EVENTS,
+};
+
+enum report_structure_key_event {
+    KEY_EVENT_OFFSET_TIME_MSB = 0,
+    KEY_EVENT_OFFSET_TIME_LSB,
+    KEY_EVENT_OFFSET_KEYCODE_MSB,
+    KEY_EVENT_OFFSET_KEYCODE_LSB,
+    KEY_EVENT_OFFSET_PRESSED,
+    KEY_EVENT_LENGTH,
+};
+
+typedef struct mouse_passthrough_stats_t {
+    uint32_t messages_sent;
+    uint32_t messages_received;
+    uint32_t queue_full;  // messages that couldn't be queued because their lane was full
+    uint32_t coalesced;   // times pending motion was summed into an already queued sample
+    uint8_t max_queue_depth;
+    uint16_t handshake_messages_sent;
+    uint16_t connections;
+    uint16_t control_retransmits;  // control payloads sent again because they weren't acknowledged in time
+    uint8_t max_send_interval_ms;  // longest minimum time between motion samples chosen by the congestion controller
+    uint16_t ingress_overflows;    // received samples dropped because the pointing device driver didn't take them in time
+    uint16_t pings_sent;
+    uint16_t pongs_received;
+    uint16_t rtt_last_ms;
+    uint16_t rtt_p50_ms;
+    uint16_t rtt_p99_ms;
+    // counters reported by the remote in its latest pong
+    uint16_t remote_messages_sent;
+    uint16_t remote_messages_received;
+    uint16_t remote_queue_full;
+    uint16_t remote_coalesced;
+    uint8_t remote_max_queue_depth;
+} mouse_passthrough_stats_t;
+
+void mouse_passthrough_get_stats(mouse_passthrough_stats_t *stats);
+void mouse_passthrough_reset_stats(void);
+#ifdef CONSOLE_ENABLE
+void mouse_passthrough_print_stats(void);
+#endif
+
+#ifdef MOUSE_PASSTHROUGH_TRANSPORT_LOOPBACK
+// the host test provides mouse_passthrough_loopback_send, and passes everything it sends to the other device's mouse_passthrough_loopback_receive
+void mouse_passthrough_loopback_send(uint8_t *data, uint8_t length);
+void mouse_passthrough_loopback_receive(uint8_t *data, uint8_t length);
+#endif
+
 #ifdef MOUSE_PASSTHROUGH_SENDER
 bool is_mouse_passthrough_connected(void);
 #endif
 
 #ifdef MOUSE_PASSTHROUGH_RECEIVER
+// senders are addressed by slot, from 0 to MOUSE_PASSTHROUGH_MAX_SENDERS - 1, in the order they connected
+#    define MOUSE_PASSTHROUGH_ALL_DEVICES 0xFF
 bool is_mouse_passthrough_connected(void);
-void mouse_passthrough_set_buttons_state(bool, bool);
-void mouse_passthrough_set_pointer_state(bool, bool);
-void mouse_passthrough_set_wheel_state(bool, bool);
+bool mouse_passthrough_is_device_connected(uint8_t device);
+void mouse_passthrough_set_buttons_state(uint8_t device, bool send, bool block);
+void mouse_passthrough_set_pointer_state(uint8_t device, bool send, bool block);
+void mouse_passthrough_set_wheel_state(uint8_t device, bool send, bool block);
+void mouse_passthrough_set_keys_state(uint8_t device, bool send, bool block);
+void mouse_passthrough_set_pointer_filter(uint8_t device, mouse_passthrough_pointer_filter_t filter);
 void mouse_passthrough_send_reset_command(void);
 #endif
@@ -0,0 +1,627 @@
+// Copyright 2025 Morgan Newell Sun
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Wire format of the messages that mouse_passthrough exchanges through the hub.
+//
+// Frames are encoded in place in their queue slot and decoded in place from the receive buffer, through packed structs that
+// mirror the report_structure_* offsets in mouse_passthrough.h. Encoders only write the fields of their own frame type, so the
+// bytes after a frame are whatever the slot held before, and decoders never read past the fields that their frame type has.
+
+#pragma once
+
+#include <stddef.h>
+#include "quantum.h"
+#include "mouse_passthrough.h"
+
+// ============================================================================
+// LAYOUT
+// ============================================================================
+
+// multi-byte fields are big endian
+typedef struct __attribute__((packed)) frame_uint16_t {
+    uint8_t msb;
+    uint8_t lsb;
+} frame_uint16_t;
+
+typedef struct __attribute__((packed)) frame_header_t {
+    uint8_t command_id;
+    uint8_t device_id;  // destination when sending, source when receiving
+} frame_header_t;
+
+typedef struct __attribute__((packed)) registration_frame_t {
+    frame_header_t header;
+    uint8_t registration;
+} registration_frame_t;
+
+// sent by the hub, with DEVICE_ID_UNASSIGNED as our own id when it shuts down
+typedef struct __attribute__((packed)) device_list_frame_t {
+    frame_header_t header;
+    uint8_t device_id_self;
+    uint8_t device_id_others[MAX_REGISTERED_DEVICES - 1];
+} device_list_frame_t;
+
+typedef struct __attribute__((packed)) handshake_frame_t {
+    frame_header_t header;
+    uint8_t step;  // 13, 26 or 39, where the other frames have their frame type
+    uint8_t version;
+    uint8_t report_size;
+    uint8_t frame_formats;
+    uint8_t features;
+} handshake_frame_t;
+
+// legacy frames carry a data payload from the sender, or a control payload from the receiver
+typedef struct __attribute__((packed)) legacy_frame_t {
+    frame_header_t header;
+    uint8_t frame_type;
+    uint8_t buttons;
+    frame_uint16_t x;
+    frame_uint16_t y;
+    frame_uint16_t v;
+    frame_uint16_t h;
+    uint8_t block_buttons;
+    uint8_t block_pointer;
+    uint8_t block_wheel;
+    uint8_t send_buttons;
+    uint8_t send_pointer;
+    uint8_t send_wheel;
+    uint8_t reset;
+    uint8_t sequence;
+    uint8_t credit;
+    uint8_t pointer_filter;
+    uint8_t pointer_interval;
+    uint8_t block_keys;
+    uint8_t send_keys;
+} legacy_frame_t;
+
+typedef struct __attribute__((packed)) packed_frame_t {
+    frame_header_t header;
+    uint8_t frame_type;
+    uint8_t count;
+    frame_uint16_t time;
+    uint8_t samples[];
+} packed_frame_t;
+
+// pings only carry the time, pongs echo it along with the responder's counters
+typedef struct __attribute__((packed)) ping_frame_t {
+    frame_header_t header;
+    uint8_t frame_type;
+    frame_uint16_t time;
+    frame_uint16_t messages_sent;
+    frame_uint16_t messages_received;
+    frame_uint16_t queue_full;
+    frame_uint16_t coalesced;
+    uint8_t max_queue_depth;
+} ping_frame_t;
+
+typedef struct __attribute__((packed)) control_ack_frame_t {
+    frame_header_t header;
+    uint8_t frame_type;
+    uint8_t sequence;
+    uint8_t block_buttons;
+    uint8_t block_pointer;
+    uint8_t block_wheel;
+    uint8_t send_buttons;
+    uint8_t send_pointer;
+    uint8_t send_wheel;
+    uint8_t reset;
+    uint8_t block_keys;
+    uint8_t send_keys;
+} control_ack_frame_t;
+
+typedef struct __attribute__((packed)) key_event_record_t {
+    frame_uint16_t time;
+    frame_uint16_t keycode;
+    uint8_t pressed;
+} key_event_record_t;
+
+// the events are followed by held_count keycodes
+typedef struct __attribute__((packed)) key_frame_t {
+    frame_header_t header;
+    uint8_t frame_type;
+    uint8_t count;
+    uint8_t held_count;
+    key_event_record_t events[];
+} key_frame_t;
+
+#define FRAME_FIELD_AT(type, field, offset) _Static_assert(offsetof(type, field) == (offset), #type "." #field " must be at " #offset)
+
+FRAME_FIELD_AT(frame_header_t, command_id, REPORT_OFFSET_COMMAND_ID);
+FRAME_FIELD_AT(frame_header_t, device_id, REPORT_OFFSET_DEVICE_ID);
+FRAME_FIELD_AT(registration_frame_t, registration, REPORT_OFFSET_REGISTRATION);
+FRAME_FIELD_AT(device_list_frame_t, device_id_self, REPORT_OFFSET_DEVICE_ID_SELF);
+FRAME_FIELD_AT(device_list_frame_t, device_id_others, REPORT_OFFSET_DEVICE_ID_OTHERS);
+FRAME_FIELD_AT(handshake_frame_t, step, REPORT_OFFSET_HANDSHAKE);
+FRAME_FIELD_AT(handshake_frame_t, version, REPORT_OFFSET_CAPABILITY_VERSION);
+FRAME_FIELD_AT(handshake_frame_t, report_size, REPORT_OFFSET_CAPABILITY_REPORT_SIZE);
+FRAME_FIELD_AT(handshake_frame_t, frame_formats, REPORT_OFFSET_CAPABILITY_FRAME_FORMATS);
+FRAME_FIELD_AT(handshake_frame_t, features, REPORT_OFFSET_CAPABILITY_FEATURES);
+FRAME_FIELD_AT(legacy_frame_t, frame_type, REPORT_OFFSET_FRAME_TYPE);
+FRAME_FIELD_AT(legacy_frame_t, buttons, REPORT_OFFSET_DATA_BUTTONS);
+FRAME_FIELD_AT(legacy_frame_t, x, REPORT_OFFSET_DATA_X_MSB);
+FRAME_FIELD_AT(legacy_frame_t, y, REPORT_OFFSET_DATA_Y_MSB);
+FRAME_FIELD_AT(legacy_frame_t, v, REPORT_OFFSET_DATA_V_MSB);
+FRAME_FIELD_AT(legacy_frame_t, h, REPORT_OFFSET_DATA_H_MSB);
+FRAME_FIELD_AT(legacy_frame_t, block_buttons, REPORT_OFFSET_CONTROL_BLOCK_BUTTONS);
+FRAME_FIELD_AT(legacy_frame_t, block_pointer, REPORT_OFFSET_CONTROL_BLOCK_POINTER);
+FRAME_FIELD_AT(legacy_frame_t, block_wheel, REPORT_OFFSET_CONTROL_BLOCK_WHEEL);
+FRAME_FIELD_AT(legacy_frame_t, send_buttons, REPORT_OFFSET_CONTROL_SEND_BUTTONS);
+FRAME_FIELD_AT(legacy_frame_t, send_pointer, REPORT_OFFSET_CONTROL_SEND_POINTER);
+FRAME_FIELD_AT(legacy_frame_t, send_wheel, REPORT_OFFSET_CONTROL_SEND_WHEEL);
+FRAME_FIELD_AT(legacy_frame_t, reset, REPORT_OFFSET_RESET);
+FRAME_FIELD_AT(legacy_frame_t, sequence, REPORT_OFFSET_CONTROL_SEQUENCE);
+FRAME_FIELD_AT(legacy_frame_t, credit, REPORT_OFFSET_CONTROL_CREDIT);
+FRAME_FIELD_AT(legacy_frame_t, pointer_filter, REPORT_OFFSET_CONTROL_POINTER_FILTER);
+FRAME_FIELD_AT(legacy_frame_t, pointer_interval, REPORT_OFFSET_CONTROL_POINTER_INTERVAL);
+FRAME_FIELD_AT(legacy_frame_t, block_keys, REPORT_OFFSET_CONTROL_BLOCK_KEYS);
+FRAME_FIELD_AT(legacy_frame_t, send_keys, REPORT_OFFSET_CONTROL_SEND_KEYS);
+FRAME_FIELD_AT(packed_frame_t, frame_type, REPORT_OFFSET_FRAME_TYPE);
+FRAME_FIELD_AT(packed_frame_t, count, REPORT_OFFSET_PACKED_COUNT);
+FRAME_FIELD_AT(packed_frame_t, time, REPORT_OFFSET_PACKED_TIME_MSB);
+FRAME_FIELD_AT(packed_frame_t, samples, REPORT_OFFSET_PACKED_SAMPLES);
+FRAME_FIELD_AT(ping_frame_t, frame_type, REPORT_OFFSET_FRAME_TYPE);
+FRAME_FIELD_AT(ping_frame_t, time, REPORT_OFFSET_PING_TIME_MSB);
+FRAME_FIELD_AT(ping_frame_t, messages_sent, REPORT_OFFSET_PONG_MESSAGES_SENT_MSB);
+FRAME_FIELD_AT(ping_frame_t, messages_received, REPORT_OFFSET_PONG_MESSAGES_RECEIVED_MSB);
+FRAME_FIELD_AT(ping_frame_t, queue_full, REPORT_OFFSET_PONG_QUEUE_FULL_MSB);
+FRAME_FIELD_AT(ping_frame_t, coalesced, REPORT_OFFSET_PONG_COALESCED_MSB);
+FRAME_FIELD_AT(ping_frame_t, max_queue_depth, REPORT_OFFSET_PONG_MAX_QUEUE_DEPTH);
+FRAME_FIELD_AT(control_ack_frame_t, frame_type, REPORT_OFFSET_FRAME_TYPE);
+FRAME_FIELD_AT(control_ack_frame_t, sequence, REPORT_OFFSET_CONTROL_ACK_SEQUENCE);
+FRAME_FIELD_AT(control_ack_frame_t, block_buttons, REPORT_OFFSET_CONTROL_ACK_BLOCK_BUTTONS);
+FRAME_FIELD_AT(control_ack_frame_t, block_pointer, REPORT_OFFSET_CONTROL_ACK_BLOCK_POINTER);
+FRAME_FIELD_AT(control_ack_frame_t, block_wheel, REPORT_OFFSET_CONTROL_ACK_BLOCK_WHEEL);
+FRAME_FIELD_AT(control_ack_frame_t, send_buttons, REPORT_OFFSET_CONTROL_ACK_SEND_BUTTONS);
+FRAME_FIELD_AT(control_ack_frame_t, send_pointer, REPORT_OFFSET_CONTROL_ACK_SEND_POINTER);
+FRAME_FIELD_AT(control_ack_frame_t, send_wheel, REPORT_OFFSET_CONTROL_ACK_SEND_WHEEL);
+FRAME_FIELD_AT(control_ack_frame_t, reset, REPORT_OFFSET_CONTROL_ACK_RESET);
+FRAME_FIELD_AT(control_ack_frame_t, block_keys, REPORT_OFFSET_CONTROL_ACK_BLOCK_KEYS);
+FRAME_FIELD_AT(control_ack_frame_t, send_keys, REPORT_OFFSET_CONTROL_ACK_SEND_KEYS);
+FRAME_FIELD_AT(key_frame_t, frame_type, REPORT_OFFSET_FRAME_TYPE);
+FRAME_FIELD_AT(key_frame_t, count, REPORT_OFFSET_KEY_COUNT);
+FRAME_FIELD_AT(key_frame_t, held_count, REPORT_OFFSET_KEY_HELD_COUNT);
+FRAME_FIELD_AT(key_frame_t, events, REPORT_OFFSET_KEY_EVENTS);
+FRAME_FIELD_AT(key_event_record_t, time, KEY_EVENT_OFFSET_TIME_MSB);
+FRAME_FIELD_AT(key_event_record_t, keycode, KEY_EVENT_OFFSET_KEYCODE_MSB);
+FRAME_FIELD_AT(key_event_record_t, pressed, KEY_EVENT_OFFSET_PRESSED);
+_Static_assert(sizeof(key_event_record_t) == KEY_EVENT_LENGTH, "key_event_record_t must be KEY_EVENT_LENGTH bytes");
+_Static_assert(sizeof(device_list_frame_t) <= QMK_RAW_HID_REPORT_SIZE, "the device list must fit in a report");
+_Static_assert(sizeof(legacy_frame_t) <= MOUSE_PASSTHROUGH_LEGACY_REPORT_SIZE, "legacy frames must fit in a legacy report");
+_Static_assert(sizeof(ping_frame_t) <= MOUSE_PASSTHROUGH_LEGACY_REPORT_SIZE, "pongs must fit in a legacy report");
+
+// ============================================================================
+// DECODED FRAMES
+// ============================================================================
+
+typedef struct handshake_t {
+    uint8_t step;
+    uint8_t version;
+    uint8_t report_size;
+    uint8_t frame_formats;
+    uint8_t features;
+} handshake_t;
+
+// control payloads and their acknowledgements carry the same block/send/reset flags
+typedef struct control_frame_t {
+    uint8_t sequence;
+    bool block_buttons;
+    bool block_pointer;
+    bool block_wheel;
+    bool send_buttons;
+    bool send_pointer;
+    bool send_wheel;
+    bool reset;
+    bool block_keys;
+    bool send_keys;
+    // control payloads only
+    uint8_t credit;
+    uint8_t pointer_filter;
+    uint8_t pointer_interval;
+} control_frame_t;
+
+typedef struct key_event_t {
+    uint16_t time;
+    uint16_t keycode;
+    bool pressed;
+} key_event_t;
+
+typedef struct packed_sample_t {
+    uint8_t flags;
+    uint8_t dt;
+    uint8_t buttons;
+    int16_t x;
+    int16_t y;
+    int16_t v;
+    int16_t h;
+} packed_sample_t;
+
+// ============================================================================
+// FIELDS
+// ============================================================================
+
+static inline void write_uint16(frame_uint16_t *field, uint16_t value) {
+    field->msb = (value >> 8) & 0xFF;
+    field->lsb = value & 0xFF;
+}
+
+static inline uint16_t read_uint16(const frame_uint16_t *field) {
+    return ((uint16_t)field->msb << 8) | field->lsb;
+}
+
+static inline int16_t read_int16(const frame_uint16_t *field) {
+    return (int16_t)read_uint16(field);
+}
+
+// ============================================================================
+// HEADER
+// ============================================================================
+
+// the fields that every frame type shares are accessed as bytes, since the compiler may assume that accesses through
+// two different frame structs never overlap, and the frame may have been written through any of them
+
+static inline void encode_header(uint8_t *message, uint8_t device_id) {
+    message[offsetof(frame_header_t, command_id)] = RAW_HID_HUB_COMMAND_ID;
+    message[offsetof(frame_header_t, device_id)] = device_id;
+}
+
+static inline uint8_t frame_command_id(const uint8_t *data) {
+    return data[offsetof(frame_header_t, command_id)];
+}
+
+static inline uint8_t frame_device_id(const uint8_t *data) {
+    return data[offsetof(frame_header_t, device_id)];
+}
+
+static inline void set_frame_device_id(uint8_t *data, uint8_t device_id) {
+    data[offsetof(frame_header_t, device_id)] = device_id;
+}
+
+// the frame type of a data or link frame, which is the step of a handshake frame
+static inline uint8_t frame_type(const uint8_t *data) {
+    return data[offsetof(legacy_frame_t, frame_type)];
+}
+
+static inline uint8_t handshake_step(const uint8_t *data) {
+    return data[offsetof(handshake_frame_t, step)];
+}
+
+// ============================================================================
+// HUB FRAMES
+// ============================================================================
+
+static inline void encode_registration(uint8_t *message) {
+    ((registration_frame_t *)message)->registration = 0x01;
+}
+
+static inline bool decode_registration(const uint8_t *data) {
+    return ((const registration_frame_t *)data)->registration == 0x01;
+}
+
+// device_id_others holds MAX_REGISTERED_DEVICES - 1 ids, DEVICE_ID_UNASSIGNED for free slots
+static inline void encode_device_list(uint8_t *message, uint8_t device_id_self, const uint8_t *device_id_others) {
+    device_list_frame_t *frame = (device_list_frame_t *)message;
+    frame->device_id_self = device_id_self;
+    memcpy(frame->device_id_others, device_id_others, sizeof(frame->device_id_others));
+}
+
+// returns the ids of the other devices
+static inline const uint8_t *decode_device_list(const uint8_t *data, uint8_t *device_id_self) {
+    const device_list_frame_t *frame = (const device_list_frame_t *)data;
+    *device_id_self = frame->device_id_self;
+    return frame->device_id_others;
+}
+
+// ============================================================================
+// HANDSHAKE FRAMES
+// ============================================================================
+
+static inline void encode_handshake(uint8_t *message, const handshake_t *handshake) {
+    handshake_frame_t *frame = (handshake_frame_t *)message;
+    frame->step = handshake->step;
+    frame->version = handshake->version;
+    frame->report_size = handshake->report_size;
+    frame->frame_formats = handshake->frame_formats;
+    frame->features = handshake->features;
+}
+
+static inline void decode_handshake(const uint8_t *data, handshake_t *handshake) {
+    const handshake_frame_t *frame = (const handshake_frame_t *)data;
+    handshake->step = frame->step;
+    handshake->version = frame->version;
+    handshake->report_size = frame->report_size;
+    handshake->frame_formats = frame->frame_formats;
+    handshake->features = frame->features;
+}
+
+// ============================================================================
+// PING FRAMES
+// ============================================================================
+
+// the time is stamped with stamp_ping when the ping is sent
+static inline void encode_ping(uint8_t *message) {
+    ((ping_frame_t *)message)->frame_type = REPORT_FRAME_PING;
+}
+
+static inline void stamp_ping(uint8_t *message, uint16_t time) {
+    write_uint16(&((ping_frame_t *)message)->time, time);
+}
+
+static inline uint16_t decode_ping(const uint8_t *data) {
+    return read_uint16(&((const ping_frame_t *)data)->time);
+}
+
+// only the lower 16 bits of the counters fit
+static inline void encode_pong(uint8_t *message, uint16_t ping_time, const mouse_passthrough_stats_t *counters) {
+    ping_frame_t *frame = (ping_frame_t *)message;
+    frame->frame_type = REPORT_FRAME_PONG;
+    write_uint16(&frame->time, ping_time);
+    write_uint16(&frame->messages_sent, counters->messages_sent);
+    write_uint16(&frame->messages_received, counters->messages_received);
+    write_uint16(&frame->queue_full, counters->queue_full);
+    write_uint16(&frame->coalesced, counters->coalesced);
+    frame->max_queue_depth = counters->max_queue_depth;
+}
+
+// returns the echoed ping time, and stores the counters in the remote_* fields
+static inline uint16_t decode_pong(const uint8_t *data, mouse_passthrough_stats_t *counters) {
+    const ping_frame_t *frame = (const ping_frame_t *)data;
+    counters->remote_messages_sent = read_uint16(&frame->messages_sent);
+    counters->remote_messages_received = read_uint16(&frame->messages_received);
+    counters->remote_queue_full = read_uint16(&frame->queue_full);
+    counters->remote_coalesced = read_uint16(&frame->coalesced);
+    counters->remote_max_queue_depth = frame->max_queue_depth;
+    return read_uint16(&frame->time);
+}
+
+// ============================================================================
+// CONTROL FRAMES
+// ============================================================================
+
+static inline void encode_control_payload(uint8_t *message, const control_frame_t *control) {
+    legacy_frame_t *frame = (legacy_frame_t *)message;
+    frame->frame_type = REPORT_FRAME_LEGACY;
+    frame->block_buttons = control->block_buttons ? 1 : 0;
+    frame->block_pointer = control->block_pointer ? 1 : 0;
+    frame->block_wheel = control->block_wheel ? 1 : 0;
+    frame->send_buttons = control->send_buttons ? 1 : 0;
+    frame->send_pointer = control->send_pointer ? 1 : 0;
+    frame->send_wheel = control->send_wheel ? 1 : 0;
+    frame->reset = control->reset ? 1 : 0;
+    frame->sequence = control->sequence;
+    frame->credit = control->credit;
+    frame->pointer_filter = control->pointer_filter;
+    frame->pointer_interval = control->pointer_interval;
+    frame->block_keys = control->block_keys ? 1 : 0;
+    frame->send_keys = control->send_keys ? 1 : 0;
+}
+
+static inline void decode_control_payload(const uint8_t *data, control_frame_t *control) {
+    const legacy_frame_t *frame = (const legacy_frame_t *)data;
+    control->sequence = frame->sequence;
+    control->block_buttons = frame->block_buttons > 0;
+    control->block_pointer = frame->block_pointer > 0;
+    control->block_wheel = frame->block_wheel > 0;
+    control->send_buttons = frame->send_buttons > 0;
+    control->send_pointer = frame->send_pointer > 0;
+    control->send_wheel = frame->send_wheel > 0;
+    control->reset = frame->reset > 0;
+    control->credit = frame->credit;
+    control->pointer_filter = frame->pointer_filter;
+    control->pointer_interval = frame->pointer_interval;
+    control->block_keys = frame->block_keys > 0;
+    control->send_keys = frame->send_keys > 0;
+}
+
+static inline void encode_control_ack(uint8_t *message, const control_frame_t *control) {
+    control_ack_frame_t *frame = (control_ack_frame_t *)message;
+    frame->frame_type = REPORT_FRAME_CONTROL_ACK;
+    frame->sequence = control->sequence;
+    frame->block_buttons = control->block_buttons ? 1 : 0;
+    frame->block_pointer = control->block_pointer ? 1 : 0;
+    frame->block_wheel = control->block_wheel ? 1 : 0;
+    frame->send_buttons = control->send_buttons ? 1 : 0;
+    frame->send_pointer = control->send_pointer ? 1 : 0;
+    frame->send_wheel = control->send_wheel ? 1 : 0;
+    frame->reset = control->reset ? 1 : 0;
+    frame->block_keys = control->block_keys ? 1 : 0;
+    frame->send_keys = control->send_keys ? 1 : 0;
+}
+
+// the fields that only control payloads carry are left alone
+static inline void decode_control_ack(const uint8_t *data, control_frame_t *control) {
+    const control_ack_frame_t *frame = (const control_ack_frame_t *)data;
+    control->sequence = frame->sequence;
+    control->block_buttons = frame->block_buttons > 0;
+    control->block_pointer = frame->block_pointer > 0;
+    control->block_wheel = frame->block_wheel > 0;
+    control->send_buttons = frame->send_buttons > 0;
+    control->send_pointer = frame->send_pointer > 0;
+    control->send_wheel = frame->send_wheel > 0;
+    control->reset = frame->reset > 0;
+    control->block_keys = frame->block_keys > 0;
+    control->send_keys = frame->send_keys > 0;
+}
+
+// ============================================================================
+// DATA FRAMES
+// ============================================================================
+
+// legacy data frames carry a single untimed sample, with the full button state
+static inline void encode_legacy_sample(uint8_t *message, const packed_sample_t *sample) {
+    legacy_frame_t *frame = (legacy_frame_t *)message;
+    frame->frame_type = REPORT_FRAME_LEGACY;
+    frame->buttons = sample->buttons;
+    write_uint16(&frame->x, (uint16_t)sample->x);
+    write_uint16(&frame->y, (uint16_t)sample->y);
+    write_uint16(&frame->v, (uint16_t)sample->v);
+    write_uint16(&frame->h, (uint16_t)sample->h);
+}
+
+static inline void decode_legacy_sample(const uint8_t *data, packed_sample_t *sample) {
+    const legacy_frame_t *frame = (const legacy_frame_t *)data;
+    sample->flags = PACKED_SAMPLE_BUTTONS;
+    sample->dt = 0;
+    sample->buttons = frame->buttons;
+    sample->x = read_int16(&frame->x);
+    sample->y = read_int16(&frame->y);
+    sample->v = read_int16(&frame->v);
+    sample->h = read_int16(&frame->h);
+}
+
+// start an empty packed frame, whose first sample is taken at time
+static inline void encode_packed_frame(uint8_t *message, uint16_t time) {
+    packed_frame_t *frame = (packed_frame_t *)message;
+    frame->frame_type = REPORT_FRAME_PACKED;
+    frame->count = 0;
+    write_uint16(&frame->time, time);
+}
+
+static inline uint8_t packed_sample_length(uint8_t flags) {
+    uint8_t length = 1;
+    if (((flags & PACKED_SAMPLE_DT_MASK) >> PACKED_SAMPLE_DT_SHIFT) == PACKED_SAMPLE_DT_ESCAPE) {
+        length += 1;
+    }
+    if (flags & PACKED_SAMPLE_BUTTONS) {
+        length += 1;
+    }
+    if (flags & PACKED_SAMPLE_XY8) {
+        length += 2;
+    } else if (flags & PACKED_SAMPLE_XY16) {
+        length += 4;
+    }
+    if (flags & PACKED_SAMPLE_VH8) {
+        length += 2;
+    } else if (flags & PACKED_SAMPLE_VH16) {
+        length += 4;
+    }
+    return length;
+}
+
+static inline uint8_t encode_packed_pair(uint8_t *out, int16_t a, int16_t b, uint8_t flag_8bit, uint8_t flag_16bit, uint8_t *flags) {
+    if (a == 0 && b == 0) {
+        return 0;
+    }
+    if (a >= INT8_MIN && a <= INT8_MAX && b >= INT8_MIN && b <= INT8_MAX) {
+        *flags |= flag_8bit;
+        out[0] = (uint8_t)(int8_t)a;
+        out[1] = (uint8_t)(int8_t)b;
+        return 2;
+    }
+    *flags |= flag_16bit;
+    write_uint16((frame_uint16_t *)out, (uint16_t)a);
+    write_uint16((frame_uint16_t *)(out + 2), (uint16_t)b);
+    return 4;
+}
+
+// encode a sample into out, which needs PACKED_SAMPLE_MAX_LENGTH bytes, only the buttons flag of sample->flags is used
+static inline uint8_t encode_packed_sample(uint8_t *out, const packed_sample_t *sample) {
+    uint8_t flags = sample->flags & PACKED_SAMPLE_BUTTONS;
+    uint8_t length = 1;
+    if (sample->dt < PACKED_SAMPLE_DT_ESCAPE) {
+        flags |= sample->dt << PACKED_SAMPLE_DT_SHIFT;
+    } else {
+        flags |= PACKED_SAMPLE_DT_ESCAPE << PACKED_SAMPLE_DT_SHIFT;
+        out[length++] = sample->dt;
+    }
+    if (flags & PACKED_SAMPLE_BUTTONS) {
+        out[length++] = sample->buttons;
+    }
+    length += encode_packed_pair(out + length, sample->x, sample->y, PACKED_SAMPLE_XY8, PACKED_SAMPLE_XY16, &flags);
+    length += encode_packed_pair(out + length, sample->v, sample->h, PACKED_SAMPLE_VH8, PACKED_SAMPLE_VH16, &flags);
+    out[0] = flags;
+    return length;
+}
+
+static inline void decode_packed_pair(const uint8_t *data, uint8_t *offset, uint8_t flags, uint8_t flag_8bit, uint8_t flag_16bit, int16_t *a, int16_t *b) {
+    if (flags & flag_8bit) {
+        *a = (int8_t)data[*offset];
+        *b = (int8_t)data[*offset + 1];
+        *offset += 2;
+    } else if (flags & flag_16bit) {
+        *a = read_int16((const frame_uint16_t *)(data + *offset));
+        *b = read_int16((const frame_uint16_t *)(data + *offset + 2));
+        *offset += 4;
+    } else {
+        *a = 0;
+        *b = 0;
+    }
+}
+
+// decode the sample at offset in the samples of a packed frame, returns the offset of the next sample
+static inline uint8_t decode_packed_sample(const uint8_t *samples, uint8_t offset, packed_sample_t *sample) {
+    sample->flags = samples[offset++];
+    sample->dt = (sample->flags & PACKED_SAMPLE_DT_MASK) >> PACKED_SAMPLE_DT_SHIFT;
+    if (sample->dt == PACKED_SAMPLE_DT_ESCAPE) {
+        sample->dt = samples[offset++];
+    }
+    sample->buttons = (sample->flags & PACKED_SAMPLE_BUTTONS) ? samples[offset++] : 0;
+    decode_packed_pair(samples, &offset, sample->flags, PACKED_SAMPLE_XY8, PACKED_SAMPLE_XY16, &sample->x, &sample->y);
+    decode_packed_pair(samples, &offset, sample->flags, PACKED_SAMPLE_VH8, PACKED_SAMPLE_VH16, &sample->v, &sample->h);
+    return offset;
+}
+
+// ============================================================================
+// KEY FRAMES
+// ============================================================================
+
+// start an empty key frame
+static inline void encode_key_frame(uint8_t *message) {
+    key_frame_t *frame = (key_frame_t *)message;
+    frame->frame_type = REPORT_FRAME_KEY;
+    frame->count = 0;
+    frame->held_count = 0;
+}
+
+// write the held keys (KC_NO for free slots) after the events of a key frame
+static inline void encode_held_keys(uint8_t *message, const uint16_t *held_keys) {
+    key_frame_t *frame = (key_frame_t *)message;
+    frame_uint16_t *held = (frame_uint16_t *)(message + sizeof(key_frame_t) + frame->count * sizeof(key_event_record_t));
+    frame->held_count = 0;
+    for (uint8_t i = 0; i < MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS; i++) {
+        if (held_keys[i] != KC_NO) {
+            write_uint16(&held[frame->held_count++], held_keys[i]);
+        }
+    }
+}
+
+// append an event to a key frame, followed by the keys held after it, returns false if the frame is full
+static inline bool encode_key_event(uint8_t *message, uint8_t report_size, const key_event_t *event, const uint16_t *held_keys) {
+    key_frame_t *frame = (key_frame_t *)message;
+    if (sizeof(key_frame_t) + (frame->count + 1) * sizeof(key_event_record_t) + MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS * sizeof(frame_uint16_t) > report_size) {
+        return false;
+    }
+    key_event_record_t *record = &frame->events[frame->count++];
+    write_uint16(&record->time, event->time);
+    write_uint16(&record->keycode, event->keycode);
+    record->pressed = event->pressed ? 1 : 0;
+    encode_held_keys(message, held_keys);
+    return true;
+}
+
+// bytes used by a key frame, which the decoder must check against the report size before reading events and held keys
+// the counts come off the wire, so the length can be far more than a report and must not wrap around to a small one
+static inline uint16_t key_frame_length(const uint8_t *data) {
+    const key_frame_t *frame = (const key_frame_t *)data;
+    return sizeof(key_frame_t) + frame->count * sizeof(key_event_record_t) + frame->held_count * sizeof(frame_uint16_t);
+}
+
+static inline void decode_key_event(const uint8_t *data, uint8_t index, key_event_t *event) {
+    const key_event_record_t *record = &((const key_frame_t *)data)->events[index];
+    event->time = read_uint16(&record->time);
+    event->keycode = read_uint16(&record->keycode);
+    event->pressed = record->pressed > 0;
+}
+
+static inline uint16_t decode_held_key(const uint8_t *data, uint8_t index) {
+    const key_frame_t *frame = (const key_frame_t *)data;
+    const frame_uint16_t *held = (const frame_uint16_t *)(data + sizeof(key_frame_t) + frame->count * sizeof(key_event_record_t));
+    return read_uint16(&held[index]);
+}
+
+static inline bool key_frame_holds(const uint8_t *data, uint16_t keycode) {
+    for (uint8_t i = 0; i < ((const key_frame_t *)data)->held_count; i++) {
+        if (decode_held_key(data, i) == keycode) {
+            return true;
+        }
+    }
+    return false;
+}
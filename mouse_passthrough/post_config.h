@@ -7,18 +7,152 @@
 #    error "You must define MOUSE_PASSTHROUGH_RECEIVER or MOUSE_PASSTHROUGH_SENDER!"
 #endif
 
+// the devices talk through the raw hid hub on the host PC, unless MOUSE_PASSTHROUGH_TRANSPORT_SPLIT (the two halves of a split keyboard)
+// or MOUSE_PASSTHROUGH_TRANSPORT_LOOPBACK (host tests) is defined
+#if defined(MOUSE_PASSTHROUGH_TRANSPORT_SPLIT) && defined(MOUSE_PASSTHROUGH_TRANSPORT_LOOPBACK)
+#    error "MOUSE_PASSTHROUGH_TRANSPORT_SPLIT and MOUSE_PASSTHROUGH_TRANSPORT_LOOPBACK cannot both be defined!"
+#endif
+
+// the master half polls the other half for messages at least this often (ms)
+#ifndef MOUSE_PASSTHROUGH_SPLIT_POLL_INTERVAL
+#    define MOUSE_PASSTHROUGH_SPLIT_POLL_INTERVAL 1
+#endif
+
 #ifndef HUB_CONNECTION_ATTEMPT_INTERVAL
 #    define HUB_CONNECTION_ATTEMPT_INTERVAL 4000
 #endif
 
+// registration is retried with exponential backoff from HUB_CONNECTION_RETRY_INTERVAL up to HUB_CONNECTION_ATTEMPT_INTERVAL
+#ifndef HUB_CONNECTION_RETRY_INTERVAL
+#    define HUB_CONNECTION_RETRY_INTERVAL 50
+#endif
+
 #ifndef HUB_CONNECTION_EXPIRY_INTERVAL
 #    define HUB_CONNECTION_EXPIRY_INTERVAL 5000
 #endif
 
+// a paired link that has received nothing for this long pings the remote to keep the connection alive
+#ifndef MOUSE_PASSTHROUGH_HEARTBEAT_INTERVAL
+#    define MOUSE_PASSTHROUGH_HEARTBEAT_INTERVAL 1000
+#endif
+
 #ifndef MAX_QUEUED_MESSAGES
 #    define MAX_QUEUED_MESSAGES 16
 #endif
 
+#ifndef MAX_QUEUED_CONTROL_MESSAGES
+#    define MAX_QUEUED_CONTROL_MESSAGES 2
+#endif
+
+#ifndef MAX_QUEUED_LINK_MESSAGES
+#    define MAX_QUEUED_LINK_MESSAGES 4
+#endif
+
+// only the sender sends mouse data
+#ifdef MOUSE_PASSTHROUGH_SENDER
+#    ifndef MAX_QUEUED_BUTTON_MESSAGES
+#        define MAX_QUEUED_BUTTON_MESSAGES 4
+#    endif
+#    ifndef MAX_QUEUED_MOTION_MESSAGES
+#        define MAX_QUEUED_MOTION_MESSAGES MAX_QUEUED_MESSAGES
+#    endif
+#else
+#    define MAX_QUEUED_BUTTON_MESSAGES 0
+#    define MAX_QUEUED_MOTION_MESSAGES 0
+#endif
+
+// receiver playout buffer, set the delay to 0 to apply samples as soon as they arrive
+#ifndef MOUSE_PASSTHROUGH_PLAYOUT_DELAY_MS
+#    define MOUSE_PASSTHROUGH_PLAYOUT_DELAY_MS 8
+#endif
+
+#ifndef MOUSE_PASSTHROUGH_PLAYOUT_BUFFER_SIZE
+#    define MOUSE_PASSTHROUGH_PLAYOUT_BUFFER_SIZE 32
+#endif
+
+#ifndef MOUSE_PASSTHROUGH_PLAYOUT_WINDOW_MS
+#    define MOUSE_PASSTHROUGH_PLAYOUT_WINDOW_MS 2000
+#endif
+
+// received samples waiting for the pointing device driver, must be a power of two up to 128
+#ifndef MOUSE_PASSTHROUGH_INGRESS_RING_SIZE
+#    define MOUSE_PASSTHROUGH_INGRESS_RING_SIZE 32
+#endif
+
+// the receiver runs the pointing device task as soon as motion or clicks are ready to report, at most once per
+// MOUSE_PASSTHROUGH_IMMEDIATE_REPORT_INTERVAL ms (0 waits for the next pointing device task instead)
+#ifndef MOUSE_PASSTHROUGH_IMMEDIATE_REPORT_INTERVAL
+#    define MOUSE_PASSTHROUGH_IMMEDIATE_REPORT_INTERVAL 0
+#endif
+
+// link statistics, set the ping interval to ping at a fixed rate even while data is flowing (0 only pings as a heartbeat)
+#ifndef MOUSE_PASSTHROUGH_PING_INTERVAL
+#    define MOUSE_PASSTHROUGH_PING_INTERVAL 0
+#endif
+
+#ifndef MOUSE_PASSTHROUGH_RTT_BUCKET_MS
+#    define MOUSE_PASSTHROUGH_RTT_BUCKET_MS 2
+#endif
+
+#ifndef MOUSE_PASSTHROUGH_RTT_BUCKETS
+#    define MOUSE_PASSTHROUGH_RTT_BUCKETS 32
+#endif
+
+// number of senders the receiver can be connected to at once
+#ifndef MOUSE_PASSTHROUGH_MAX_SENDERS
+#    define MOUSE_PASSTHROUGH_MAX_SENDERS 2
+#endif
+
+// device ids of the last paired peers, kept at MOUSE_PASSTHROUGH_EECONFIG_USER_DATA_OFFSET in the EECONFIG user datablock if it's defined
+#ifdef MOUSE_PASSTHROUGH_SENDER
+#    define MOUSE_PASSTHROUGH_PEER_CACHE_SIZE 1
+#else
+#    define MOUSE_PASSTHROUGH_PEER_CACHE_SIZE MOUSE_PASSTHROUGH_MAX_SENDERS
+#endif
+
+// unacknowledged control payloads are retransmitted every MOUSE_PASSTHROUGH_CONTROL_RETRY_INTERVAL ms, at most MOUSE_PASSTHROUGH_CONTROL_MAX_RETRIES times
+#ifndef MOUSE_PASSTHROUGH_CONTROL_RETRY_INTERVAL
+#    define MOUSE_PASSTHROUGH_CONTROL_RETRY_INTERVAL 50
+#endif
+
+#ifndef MOUSE_PASSTHROUGH_CONTROL_MAX_RETRIES
+#    define MOUSE_PASSTHROUGH_CONTROL_MAX_RETRIES 8
+#endif
+
+// sender congestion control: the minimum time between motion samples doubles while more than MOUSE_PASSTHROUGH_CONGESTION_TARGET_DEPTH
+// motion frames are queued or the receiver is low on credit, and shrinks by 1 ms otherwise, at most once per MOUSE_PASSTHROUGH_CONGESTION_HOLD_MS
+#ifndef MOUSE_PASSTHROUGH_CONGESTION_TARGET_DEPTH
+#    define MOUSE_PASSTHROUGH_CONGESTION_TARGET_DEPTH 1
+#endif
+
+#ifndef MOUSE_PASSTHROUGH_CONGESTION_HOLD_MS
+#    define MOUSE_PASSTHROUGH_CONGESTION_HOLD_MS 16
+#endif
+
+#ifndef MOUSE_PASSTHROUGH_MAX_SEND_INTERVAL
+#    define MOUSE_PASSTHROUGH_MAX_SEND_INTERVAL 32
+#endif
+
+// the receiver reports low credit when fewer than this many samples fit in a sender's playout buffer, and clears it at twice as many
+#ifndef MOUSE_PASSTHROUGH_LOW_CREDIT
+#    define MOUSE_PASSTHROUGH_LOW_CREDIT 8
+#endif
+
+// keys held down at once whose events are forwarded, further presses are handled by the sender as if forwarding was off
+// the held keys are sent again every MOUSE_PASSTHROUGH_KEY_REFRESH_INTERVAL ms, so that a lost key frame doesn't leave a key stuck
+#ifndef MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS
+#    define MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS 6
+#endif
+
+#ifndef MOUSE_PASSTHROUGH_KEY_REFRESH_INTERVAL
+#    define MOUSE_PASSTHROUGH_KEY_REFRESH_INTERVAL 100
+#endif
+
+// matrix row that forwarded key events are injected at, it must be above the keyboard's matrix and below the rows QMK reserves
+#ifndef MOUSE_PASSTHROUGH_KEY_ROW
+#    define MOUSE_PASSTHROUGH_KEY_ROW 240
+#endif
+
 #ifndef RAW_HID_HUB_COMMAND_ID
 #    define RAW_HID_HUB_COMMAND_ID 0x27
 #endif
@@ -41,4 +175,33 @@
 
 #ifndef MAX_REGISTERED_DEVICES
 #    define MAX_REGISTERED_DEVICES 30
-#endif
\ No newline at end of file
+#endif
+
+#if MOUSE_PASSTHROUGH_HEARTBEAT_INTERVAL * 2 >= HUB_CONNECTION_EXPIRY_INTERVAL
+#    error "MOUSE_PASSTHROUGH_HEARTBEAT_INTERVAL must be less than half of HUB_CONNECTION_EXPIRY_INTERVAL, so that a lost heartbeat doesn't drop the link!"
+#endif
+
+#if MOUSE_PASSTHROUGH_MAX_SENDERS < 1 || MOUSE_PASSTHROUGH_MAX_SENDERS > MAX_REGISTERED_DEVICES - 1
+#    error "MOUSE_PASSTHROUGH_MAX_SENDERS must be between 1 and MAX_REGISTERED_DEVICES - 1!"
+#endif
+
+#if MOUSE_PASSTHROUGH_MAX_SEND_INTERVAL < 1 || MOUSE_PASSTHROUGH_MAX_SEND_INTERVAL > 255
+#    error "MOUSE_PASSTHROUGH_MAX_SEND_INTERVAL must be between 1 and 255!"
+#endif
+
+#if MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS < 1 || MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS > 8
+#    error "MOUSE_PASSTHROUGH_MAX_FORWARDED_KEYS must be between 1 and 8, so that the held keys fit in a key frame!"
+#endif
+
+#if MOUSE_PASSTHROUGH_INGRESS_RING_SIZE < 1 || MOUSE_PASSTHROUGH_INGRESS_RING_SIZE > 128 || (MOUSE_PASSTHROUGH_INGRESS_RING_SIZE & (MOUSE_PASSTHROUGH_INGRESS_RING_SIZE - 1)) != 0
+#    error "MOUSE_PASSTHROUGH_INGRESS_RING_SIZE must be a power of two up to 128!"
+#endif
+
+// the peer cache takes a magic byte plus two bytes per peer
+#if defined(MOUSE_PASSTHROUGH_EECONFIG_USER_DATA_OFFSET) && (!defined(EECONFIG_USER_DATA_SIZE) || MOUSE_PASSTHROUGH_EECONFIG_USER_DATA_OFFSET + 1 + MOUSE_PASSTHROUGH_PEER_CACHE_SIZE * 2 > EECONFIG_USER_DATA_SIZE)
+#    error "EECONFIG_USER_DATA_SIZE must leave room for the peer cache at MOUSE_PASSTHROUGH_EECONFIG_USER_DATA_OFFSET!"
+#endif
+
+#if MOUSE_PASSTHROUGH_LOW_CREDIT * 2 > MOUSE_PASSTHROUGH_PLAYOUT_BUFFER_SIZE
+#    error "MOUSE_PASSTHROUGH_LOW_CREDIT must be at most half of MOUSE_PASSTHROUGH_PLAYOUT_BUFFER_SIZE!"
+#endif
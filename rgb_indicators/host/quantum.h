@@ -0,0 +1,44 @@
+// Copyright 2025 Morgan Newell Sun
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Minimal stand-in for QMK's quantum.h, just enough to build rgb_indicators.c on a host PC.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ASSERT_COMMUNITY_MODULES_MIN_API_VERSION(major, minor, patch)
+
+typedef struct {
+    uint8_t h;
+    uint8_t s;
+    uint8_t v;
+} HSV;
+
+typedef struct {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+} RGB;
+
+uint32_t timer_read32(void);
+uint32_t timer_elapsed32(uint32_t last);
+
+RGB hsv_to_rgb(HSV hsv);
+void rgblight_sethsv_noeeprom(uint8_t hue, uint8_t sat, uint8_t val);
+
+#ifdef RGB_INDICATORS_RGB_MATRIX
+#    ifndef RGB_MATRIX_LED_COUNT
+#        define RGB_MATRIX_LED_COUNT 1
+#    endif
+#    define RGB_MATRIX_NONE 0
+#    define RGB_MATRIX_SOLID_COLOR 1
+#    define RGB_MATRIX_MAXIMUM_BRIGHTNESS 255
+void rgb_matrix_mode_noeeprom(uint8_t mode);
+void rgb_matrix_sethsv_noeeprom(uint8_t hue, uint8_t sat, uint8_t val);
+void rgb_matrix_set_color(int index, uint8_t red, uint8_t green, uint8_t blue);
+#endif
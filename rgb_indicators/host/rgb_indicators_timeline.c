@@ -0,0 +1,232 @@
+// Copyright 2025 Morgan Newell Sun
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Host-side timeline renderer for rgb_indicators.
+//
+// Builds rgb_indicators.c against stubbed timer and LED functions, plays back a script of
+// rgb_indicators_start_transition calls on a virtual clock, and prints the resulting colors as CSV.
+// LED writes are counted so that update-rate changes can be measured without flashing a board.
+//
+// Build (from the repository root):
+//     cc -O2 -I rgb_indicators/host -I rgb_indicators -o rgb_indicators_timeline rgb_indicators/host/rgb_indicators_timeline.c -lm
+// Timing and color defines can be overridden on the command line, e.g. '-DTIMING_FLASH=".fade_in_ms = 100, .hold_ms = 200, .fade_out_ms = 400"'.
+// Add -DRGB_INDICATORS_RGB_MATRIX -DRGB_MATRIX_LED_COUNT=<n> to exercise the rgb_matrix backend instead.
+//
+// Script format, one event per line (blank lines and lines starting with # are ignored):
+//     <time_ms> <transition_idx> <state_idx>
+//     end <time_ms>
+// The indices refer to the tables in eynsai_statemachine/eynsai_statemachine_indicators.h.
+
+#include <stdio.h>
+#include "quantum.h"
+
+// ============================================================================
+// STUBS
+// ============================================================================
+
+static uint32_t virtual_time = 0;
+static uint32_t led_writes = 0;
+static RGB current_rgb;
+static HSV current_hsv;
+
+uint32_t timer_read32(void) {
+    return virtual_time;
+}
+
+uint32_t timer_elapsed32(uint32_t last) {
+    return virtual_time - last;
+}
+
+RGB hsv_to_rgb(HSV hsv) {
+    RGB rgb;
+    if (hsv.s == 0) {
+        rgb.r = rgb.g = rgb.b = hsv.v;
+        return rgb;
+    }
+    uint16_t h = hsv.h * 6;
+    uint8_t region = h >> 8;
+    uint8_t remainder = h & 0xFF;
+    uint8_t p = (hsv.v * (255 - hsv.s)) >> 8;
+    uint8_t q = (hsv.v * (255 - ((hsv.s * remainder) >> 8))) >> 8;
+    uint8_t t = (hsv.v * (255 - ((hsv.s * (255 - remainder)) >> 8))) >> 8;
+    switch (region) {
+        case 0: rgb = (RGB){ hsv.v, t, p }; break;
+        case 1: rgb = (RGB){ q, hsv.v, p }; break;
+        case 2: rgb = (RGB){ p, hsv.v, t }; break;
+        case 3: rgb = (RGB){ p, q, hsv.v }; break;
+        case 4: rgb = (RGB){ t, p, hsv.v }; break;
+        default: rgb = (RGB){ hsv.v, p, q }; break;
+    }
+    return rgb;
+}
+
+void rgblight_sethsv_noeeprom(uint8_t hue, uint8_t sat, uint8_t val) {
+    current_hsv = (HSV){ hue, sat, val };
+    current_rgb = hsv_to_rgb(current_hsv);
+    led_writes++;
+}
+
+#ifdef RGB_INDICATORS_RGB_MATRIX
+static uint8_t matrix_mode = RGB_MATRIX_NONE;
+static HSV matrix_hsv;
+static RGB leds[RGB_MATRIX_LED_COUNT];
+
+bool rgb_matrix_indicators_rgb_indicators(void);
+
+void rgb_matrix_mode_noeeprom(uint8_t mode) {
+    matrix_mode = mode;
+}
+
+void rgb_matrix_sethsv_noeeprom(uint8_t hue, uint8_t sat, uint8_t val) {
+    matrix_hsv = (HSV){ hue, sat, val };
+}
+
+// every call is a write, since the effect has overwritten the LED since the last frame
+void rgb_matrix_set_color(int index, uint8_t red, uint8_t green, uint8_t blue) {
+    leds[index] = (RGB){ red, green, blue };
+    led_writes++;
+}
+
+// like rgb_matrix_task: the effect renders every LED, then the indicator hooks run on top, but only if there is an effect
+static void rgb_matrix_frame(void) {
+    if (matrix_mode == RGB_MATRIX_NONE) {
+        return;
+    }
+    for (int led = 0; led < RGB_MATRIX_LED_COUNT; led++) {
+        leds[led] = hsv_to_rgb(matrix_hsv);
+    }
+    rgb_matrix_indicators_rgb_indicators();
+    // the CSV shows the first LED
+    current_rgb = leds[0];
+}
+#endif
+
+// ============================================================================
+// MODULE UNDER TEST
+// ============================================================================
+
+#include "../post_config.h"
+#include "../rgb_indicators.c"
+#include "../../eynsai_statemachine/post_config.h"
+#include "../../eynsai_statemachine/eynsai_statemachine_indicators.c"
+
+// ============================================================================
+// PLAYBACK
+// ============================================================================
+
+#define MAX_SCRIPT_EVENTS 1024
+#define DEFAULT_TAIL_MS 3000
+
+typedef struct script_event_t {
+    uint32_t time_ms;
+    uint8_t transition_idx;
+    uint8_t state_idx;
+} script_event_t;
+
+static script_event_t script[MAX_SCRIPT_EVENTS];
+static size_t script_length = 0;
+static uint32_t script_end_ms = 0;
+
+static bool load_script(FILE *file) {
+    char line[256];
+    unsigned long line_number = 0;
+    bool explicit_end = false;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        char *text = line;
+        while (*text == ' ' || *text == '\t') text++;
+        if (*text == '#' || *text == '\n' || *text == '\r' || *text == '\0') {
+            continue;
+        }
+        unsigned long time_ms, transition_idx, state_idx;
+        if (sscanf(text, "end %lu", &time_ms) == 1) {
+            script_end_ms = time_ms;
+            explicit_end = true;
+        } else if (sscanf(text, "%lu %lu %lu", &time_ms, &transition_idx, &state_idx) == 3) {
+            if (transition_idx >= sizeof(rgb_indicator_transitions) / sizeof(rgb_indicator_transitions[0]) || state_idx >= sizeof(rgb_indicator_states) / sizeof(rgb_indicator_states[0])) {
+                fprintf(stderr, "line %lu: index out of range\n", line_number);
+                return false;
+            }
+            if (script_length == MAX_SCRIPT_EVENTS) {
+                fprintf(stderr, "line %lu: too many events\n", line_number);
+                return false;
+            }
+            script[script_length++] = (script_event_t){ time_ms, transition_idx, state_idx };
+            if (!explicit_end && time_ms + DEFAULT_TAIL_MS > script_end_ms) {
+                script_end_ms = time_ms + DEFAULT_TAIL_MS;
+            }
+        } else {
+            fprintf(stderr, "line %lu: could not parse '%s'\n", line_number, text);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    uint32_t sample_interval_ms = 10;
+    uint32_t tick_ms = 1;
+    const char *script_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            sample_interval_ms = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            tick_ms = strtoul(argv[++i], NULL, 10);
+        } else if (argv[i][0] != '-' && script_path == NULL) {
+            script_path = argv[i];
+        } else {
+            fprintf(stderr, "usage: %s [-s sample_interval_ms] [-t housekeeping_tick_ms] [script]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (sample_interval_ms == 0 || tick_ms == 0) {
+        fprintf(stderr, "intervals must be nonzero\n");
+        return 2;
+    }
+
+    FILE *file = script_path != NULL ? fopen(script_path, "r") : stdin;
+    if (file == NULL) {
+        perror(script_path);
+        return 1;
+    }
+    bool loaded = load_script(file);
+    if (file != stdin) {
+        fclose(file);
+    }
+    if (!loaded) {
+        return 1;
+    }
+
+    keyboard_post_init_rgb_indicators();
+
+    size_t next_event = 0;
+    uint32_t window_start_writes = led_writes;
+    uint32_t peak_writes_per_second = 0;
+    printf("time_ms,h,s,v,r,g,b,led_writes\n");
+    for (virtual_time = 0; virtual_time <= script_end_ms; virtual_time += tick_ms) {
+        while (next_event < script_length && script[next_event].time_ms <= virtual_time) {
+            rgb_indicators_start_transition(script[next_event].transition_idx, script[next_event].state_idx);
+            next_event++;
+        }
+        housekeeping_task_rgb_indicators();
+#ifdef RGB_INDICATORS_RGB_MATRIX
+        rgb_matrix_frame();
+#endif
+
+        if (virtual_time % sample_interval_ms < tick_ms) {
+            printf("%lu,%u,%u,%u,%u,%u,%u,%lu\n", (unsigned long)virtual_time, last_set_color.h, last_set_color.s, last_set_color.v, current_rgb.r, current_rgb.g, current_rgb.b, (unsigned long)led_writes);
+        }
+        if (virtual_time % 1000 < tick_ms) {
+            uint32_t window_writes = led_writes - window_start_writes;
+            if (window_writes > peak_writes_per_second) {
+                peak_writes_per_second = window_writes;
+            }
+            window_start_writes = led_writes;
+        }
+    }
+
+    double seconds = (script_end_ms > 0 ? script_end_ms : 1) / 1000.0;
+    fprintf(stderr, "led writes: %lu total, %.1f per second average, %lu per second peak\n", (unsigned long)led_writes, led_writes / seconds, (unsigned long)peak_writes_per_second);
+    return 0;
+}
@@ -8,3 +8,16 @@
 #ifndef RGBLIGHT_LIMIT_VAL
 #    define RGBLIGHT_LIMIT_VAL 100
 #endif
+
+#ifndef RGB_INDICATORS_MAX_KEYFRAMES
+#    define RGB_INDICATORS_MAX_KEYFRAMES 4
+#endif
+
+// time a transition's accent stays up before a newer request may interrupt it (ms), unless the transition sets min_visible_ms
+#ifndef RGB_INDICATORS_MIN_VISIBLE_MS
+#    define RGB_INDICATORS_MIN_VISIBLE_MS 100
+#endif
+
+#if defined(RGB_MATRIX_ENABLE) && !defined(RGBLIGHT_ENABLE) && !defined(RGB_INDICATORS_RGB_MATRIX)
+#    define RGB_INDICATORS_RGB_MATRIX
+#endif
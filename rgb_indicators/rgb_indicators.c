@@ -9,28 +9,67 @@ ASSERT_COMMUNITY_MODULES_MIN_API_VERSION(1, 1, 0);
 // STATE
 // ============================================================================
 
-typedef enum rgb_indicator_step_t {
-    RGB_INDICATOR_STEP_FADE_IN = 0,
-    RGB_INDICATOR_STEP_HOLD,
-    RGB_INDICATOR_STEP_FADE_OUT,
-    RGB_INDICATOR_STEP_STATIC,
-    RGB_INDICATOR_STEP_BREATHING,
-} rgb_indicator_step_t;
+typedef enum rgb_indicator_track_kind_t {
+    RGB_INDICATOR_TRACK_STATIC = 0,
+    RGB_INDICATOR_TRACK_TRANSITION,
+    RGB_INDICATOR_TRACK_BREATHING,
+} rgb_indicator_track_kind_t;
+
+// a single interpolation between two keyframes, with everything the housekeeping task needs precomputed
+typedef struct rgb_indicator_segment_t {
+    uint32_t start_ms;        // relative to the start of the track
+    uint32_t end_ms;          // relative to the start of the track
+    float duration_inv;
+    HSV color_initial;        // already passed through hsv_simplify_pair
+    HSV color_final;          // already passed through hsv_simplify_pair
+#ifdef RGB_INDICATORS_RGB_MATRIX
+    const uint8_t *mask_initial;
+    const uint8_t *mask_final;
+    bool from_snapshot;       // start from whatever each LED showed when the track was compiled
+#endif
+} rgb_indicator_segment_t;
+
+// each keyframe needs a fade and a hold segment, plus one extra segment for fading out to the target state
+#define RGB_INDICATORS_MAX_SEGMENTS (2 * RGB_INDICATORS_MAX_KEYFRAMES + 1)
+
+static rgb_indicator_segment_t track_segments[RGB_INDICATORS_MAX_SEGMENTS];
+static uint8_t track_segment_count;
+static uint8_t track_cursor;
+static uint32_t track_length;
+static uint32_t track_start_time;
+static rgb_indicator_track_kind_t track_kind;
 
 static size_t transition_idx;
 static size_t state_idx;
-static rgb_indicator_step_t current_step;
-
-static uint32_t lerp_start_time;
-static uint32_t lerp_duration;
-static float lerp_duration_inv;
-static HSV lerp_color_initial;
-static HSV lerp_color_final;
 static bool breathing_forward;
 
+// transition queue: the active transition plus at most one pending transition
+// the pending transition has never been shown, so a newer request simply replaces it
+typedef struct rgb_indicator_request_t {
+    uint8_t transition_idx;
+    uint8_t state_idx;
+} rgb_indicator_request_t;
+
+static rgb_indicator_request_t pending_request;
+static bool pending_request_queued = false;
+static bool transition_visible = false;
+static uint32_t transition_visible_time;
+static uint32_t transition_accent_ms;    // relative to the start of the track; when the first accent keyframe is reached
+
 static uint32_t last_update_time = 0;
 static HSV last_set_color;
 
+#ifdef RGB_INDICATORS_RGB_MATRIX
+// framebuffer holds what was last rendered to each LED, so that only changed LEDs are converted to RGB
+// the lit LEDs in led_colors are written over the effect on every rgb_matrix frame, since the effect blanks them each frame
+static HSV framebuffer[RGB_MATRIX_LED_COUNT];
+static HSV snapshot[RGB_MATRIX_LED_COUNT];
+static RGB led_colors[RGB_MATRIX_LED_COUNT];
+static bool framebuffer_valid = false;
+#else
+static bool last_set_color_valid = false;
+#endif
+
 // ============================================================================
 // INTERNAL FUNCTIONS
 // ============================================================================
@@ -72,8 +111,69 @@ static HSV hsv_lerp(HSV initial, HSV final, float ratio) {
     return result;
 }
 
-static void hsv_set(HSV color) {
+static bool hsv_equal(HSV a, HSV b) {
+    return a.h == b.h && a.s == b.s && a.v == b.v;
+}
+
+#ifdef RGB_INDICATORS_RGB_MATRIX
+
+static bool led_mask_contains(const uint8_t *mask, uint16_t led) {
+    return mask == NULL || (mask[led / 8] & (1 << (led % 8))) != 0;
+}
+
+static void led_set(uint16_t led, HSV color) {
+    // unlit LEDs look the same regardless of hue
+    if (framebuffer_valid && (hsv_equal(color, framebuffer[led]) || (color.v == 0 && framebuffer[led].v == 0))) {
+        return;
+    }
+    framebuffer[led] = color;
+    color.v = color.v <= RGB_MATRIX_MAXIMUM_BRIGHTNESS ? color.v : RGB_MATRIX_MAXIMUM_BRIGHTNESS;
+    led_colors[led] = hsv_to_rgb(color);
+}
+
+static void render_static(HSV color, const uint8_t *mask) {
+    HSV off = { .h = color.h, .s = color.s, .v = 0 };
+    for (uint16_t led = 0; led < RGB_MATRIX_LED_COUNT; led++) {
+        led_set(led, led_mask_contains(mask, led) ? color : off);
+    }
+    framebuffer_valid = true;
+    last_set_color = color;
+}
+
+static void render_segment(const rgb_indicator_segment_t *segment, float ratio) {
+    // every LED is in one of four situations, so only interpolate each of them once per frame
+    HSV off_initial = { .h = segment->color_initial.h, .s = segment->color_initial.s, .v = 0 };
+    HSV off_final = { .h = segment->color_final.h, .s = segment->color_final.s, .v = 0 };
+    HSV lit = hsv_lerp(segment->color_initial, segment->color_final, ratio);
+    HSV fading_out = hsv_lerp(segment->color_initial, off_initial, ratio);
+    HSV fading_in = hsv_lerp(off_final, segment->color_final, ratio);
+
+    for (uint16_t led = 0; led < RGB_MATRIX_LED_COUNT; led++) {
+        bool in_final = led_mask_contains(segment->mask_final, led);
+        if (segment->from_snapshot) {
+            HSV initial = snapshot[led];
+            HSV final = in_final ? segment->color_final : (HSV){ .h = initial.h, .s = initial.s, .v = 0 };
+            hsv_simplify_pair(&initial, &final);
+            led_set(led, hsv_lerp(initial, final, ratio));
+        } else if (led_mask_contains(segment->mask_initial, led)) {
+            led_set(led, in_final ? lit : fading_out);
+        } else {
+            led_set(led, in_final ? fading_in : off_final);
+        }
+    }
+    framebuffer_valid = true;
+    last_set_color = lit;
+}
+
+#else
+
+static void render_static(HSV color, const uint8_t *mask) {
+    // skip redundant led pushes
+    if (last_set_color_valid && hsv_equal(color, last_set_color)) {
+        return;
+    }
     last_set_color = color;
+    last_set_color_valid = true;
     rgblight_sethsv_noeeprom(
         color.h,
         color.s,
@@ -81,29 +181,133 @@ static void hsv_set(HSV color) {
     );
 }
 
+static void render_segment(const rgb_indicator_segment_t *segment, float ratio) {
+    render_static(hsv_lerp(segment->color_initial, segment->color_final, ratio), NULL);
+}
+
+#endif  // RGB_INDICATORS_RGB_MATRIX
+
+static uint8_t hue_distance(HSV a, HSV b) {
+    int16_t d = abs((int16_t)a.h - (int16_t)b.h);
+    return d > 127 ? 256 - d : d;
+}
+
+static void track_reset(rgb_indicator_track_kind_t kind, uint32_t start_time) {
+    track_kind = kind;
+    track_segment_count = 0;
+    track_cursor = 0;
+    track_length = 0;
+    track_start_time = start_time;
+}
+
+static bool track_append(HSV color_initial, const uint8_t *mask_initial, HSV color_final, const uint8_t *mask_final, uint16_t duration_ms) {
+    // zero-length segments would never be rendered, so don't bother storing them
+    if (duration_ms == 0 || track_segment_count >= RGB_INDICATORS_MAX_SEGMENTS) {
+        return false;
+    }
+    rgb_indicator_segment_t *segment = &track_segments[track_segment_count++];
+    segment->start_ms = track_length;
+    track_length += duration_ms;
+    segment->end_ms = track_length;
+    segment->duration_inv = 1.0f / (float)duration_ms;
+    segment->color_initial = color_initial;
+    segment->color_final = color_final;
+    hsv_simplify_pair(&segment->color_initial, &segment->color_final);
+#ifdef RGB_INDICATORS_RGB_MATRIX
+    segment->mask_initial = mask_initial;
+    segment->mask_final = mask_final;
+    segment->from_snapshot = false;
+#endif
+    return true;
+}
+
+static void compile_state_track(uint32_t start_time) {
+    const rgb_indicator_state_t *target = &rgb_indicator_states[state_idx];
+    if (!target->breathing || target->period_ms == 0) {
+        track_reset(RGB_INDICATOR_TRACK_STATIC, start_time);
+        render_static(target->color_a, target->led_mask);
+        return;
+    }
+    track_reset(RGB_INDICATOR_TRACK_BREATHING, start_time);
+    HSV color_initial = breathing_forward ? target->color_a : target->color_b;
+    HSV color_final = breathing_forward ? target->color_b : target->color_a;
+    track_append(color_initial, target->led_mask, color_final, target->led_mask, target->period_ms);
+    track_append(color_final, target->led_mask, color_initial, target->led_mask, target->period_ms);
+}
+
+static void compile_transition_track(uint8_t t_idx, uint32_t start_time) {
+    const rgb_indicator_transition_t *transition = &rgb_indicator_transitions[t_idx];
+    transition_idx = t_idx;
+    transition_visible = false;
+    const rgb_indicator_state_t *target = &rgb_indicator_states[state_idx];
+
+    // the single accent color form is just shorthand for a one-keyframe track
+    rgb_indicator_keyframe_t accent = { .color = transition->accent_color, .fade_ms = transition->fade_in_ms, .hold_ms = transition->hold_ms };
+    const rgb_indicator_keyframe_t *keyframes = &accent;
+    uint8_t keyframe_count = 1;
+    if (transition->keyframes != NULL && transition->keyframe_count > 0) {
+        keyframes = transition->keyframes;
+        keyframe_count = transition->keyframe_count < RGB_INDICATORS_MAX_KEYFRAMES ? transition->keyframe_count : RGB_INDICATORS_MAX_KEYFRAMES;
+    }
+
+    track_reset(RGB_INDICATOR_TRACK_TRANSITION, start_time);
+    transition_accent_ms = keyframes[0].fade_ms;
+    HSV previous = last_set_color;
+    const uint8_t *previous_mask = NULL;
+#ifdef RGB_INDICATORS_RGB_MATRIX
+    memcpy(snapshot, framebuffer, sizeof(snapshot));
+#endif
+    for (uint8_t i = 0; i < keyframe_count; i++) {
+        bool appended = track_append(previous, previous_mask, keyframes[i].color, transition->led_mask, keyframes[i].fade_ms);
+#ifdef RGB_INDICATORS_RGB_MATRIX
+        // LEDs may be caught mid-fade between two masks, so fade in from exactly what they show right now
+        if (i == 0 && appended) {
+            track_segments[0].from_snapshot = true;
+        }
+#else
+        (void)appended;
+#endif
+        track_append(keyframes[i].color, transition->led_mask, keyframes[i].color, transition->led_mask, keyframes[i].hold_ms);
+        previous = keyframes[i].color;
+        previous_mask = transition->led_mask;
+    }
+
+    // fade out to whichever breathing endpoint is closest in hue, and start breathing from there
+    HSV target_color = target->color_a;
+    breathing_forward = true;
+    if (target->breathing && hue_distance(target->color_a, previous) >= hue_distance(target->color_b, previous)) {
+        target_color = target->color_b;
+        breathing_forward = false;
+    }
+    track_append(previous, previous_mask, target_color, target->led_mask, transition->fade_out_ms);
+}
+
+static bool transition_interruptible(void) {
+    if (track_kind != RGB_INDICATOR_TRACK_TRANSITION || !transition_visible) {
+        return true;
+    }
+    uint16_t min_visible_ms = rgb_indicator_transitions[transition_idx].min_visible_ms;
+    if (min_visible_ms == 0) {
+        min_visible_ms = RGB_INDICATORS_MIN_VISIBLE_MS;
+    }
+    return timer_elapsed32(transition_visible_time) >= min_visible_ms;
+}
+
 // ============================================================================
 // MODULE API
 // ============================================================================
 
 void keyboard_post_init_rgb_indicators(void) {
+#ifdef RGB_INDICATORS_RGB_MATRIX
+    // rgb_matrix only runs the indicator hooks on top of an effect, so a solid black one is kept running underneath them
+    rgb_matrix_mode_noeeprom(RGB_MATRIX_SOLID_COLOR);
+    rgb_matrix_sethsv_noeeprom(0, 0, 0);
+#endif
     state_idx = 0; // Default to first state
-    transition_idx = 0; // No transition in progress
-
-    const rgb_indicator_state_t *initial_state = &rgb_indicator_states[state_idx];
-
-    if (initial_state->breathing) {
-        current_step = RGB_INDICATOR_STEP_BREATHING;
-        lerp_start_time = timer_read32();
-        lerp_duration = initial_state->period_ms;
-        lerp_duration_inv = (lerp_duration > 0) ? (1.0f / (float)lerp_duration) : 1.0f;
-        lerp_color_initial = initial_state->color_a;
-        lerp_color_final = initial_state->color_b;
-        hsv_simplify_pair(&lerp_color_initial, &lerp_color_final);
-        breathing_forward = true;
-        hsv_set(lerp_color_initial);
-    } else {
-        current_step = RGB_INDICATOR_STEP_STATIC;
-        hsv_set(initial_state->color_a);
+    breathing_forward = true;
+    compile_state_track(timer_read32());
+    if (track_kind != RGB_INDICATOR_TRACK_STATIC) {
+        render_segment(&track_segments[0], 0.0f);
     }
 }
 
@@ -114,113 +318,87 @@ void housekeeping_task_rgb_indicators(void) {
     }
     last_update_time = now;
 
-    if (current_step == RGB_INDICATOR_STEP_STATIC) {
+    // start the pending transition once the active one has been shown for long enough
+    if (pending_request_queued && transition_interruptible()) {
+        pending_request_queued = false;
+        state_idx = pending_request.state_idx;
+        compile_transition_track(pending_request.transition_idx, now);
+    }
+
+    if (track_kind == RGB_INDICATOR_TRACK_STATIC) {
         // No processing needed
         return;
     }
 
-    uint32_t elapsed = now - lerp_start_time;
-
-    // Handle step transitions
-    if (elapsed >= lerp_duration) {
-        switch (current_step) {
-            case RGB_INDICATOR_STEP_FADE_IN:
-                current_step = RGB_INDICATOR_STEP_HOLD;
-                lerp_start_time = now;
-                lerp_duration = rgb_indicator_transitions[transition_idx].hold_ms;
-                lerp_duration_inv = (lerp_duration > 0) ? (1.0f / (float)lerp_duration) : 1.0f;
-                lerp_color_initial = rgb_indicator_transitions[transition_idx].accent_color;
-                lerp_color_final = rgb_indicator_transitions[transition_idx].accent_color;
-                hsv_simplify_pair(&lerp_color_initial, &lerp_color_final);
-                break;
-
-            case RGB_INDICATOR_STEP_HOLD:
-                current_step = RGB_INDICATOR_STEP_FADE_OUT;
-                lerp_start_time = now;
-                lerp_duration = rgb_indicator_transitions[transition_idx].fade_out_ms;
-                lerp_duration_inv = (lerp_duration > 0) ? (1.0f / (float)lerp_duration) : 1.0f;
-                lerp_color_initial = rgb_indicator_transitions[transition_idx].accent_color;
-                {
-                    const rgb_indicator_state_t *target = &rgb_indicator_states[state_idx];
-                    if (target->breathing) {
-                        int16_t d_a = abs((int16_t)target->color_a.h - (int16_t)lerp_color_initial.h);
-                        int16_t d_b = abs((int16_t)target->color_b.h - (int16_t)lerp_color_initial.h);
-                        if (d_a > 127) d_a = 256 - d_a;
-                        if (d_b > 127) d_b = 256 - d_b;
-                        if (d_a < d_b) {
-                            lerp_color_final = target->color_a;
-                            breathing_forward = true;
-                        } else {
-                            lerp_color_final = target->color_b;
-                            breathing_forward = false;
-                        }
-                    } else {
-                        lerp_color_final = target->color_a;
-                    }
-                }
-                hsv_simplify_pair(&lerp_color_initial, &lerp_color_final);
-                break;
-
-            case RGB_INDICATOR_STEP_FADE_OUT: {
-                const rgb_indicator_state_t *target = &rgb_indicator_states[state_idx];
-                if (target->breathing) {
-                    current_step = RGB_INDICATOR_STEP_BREATHING;
-                    lerp_start_time = now;
-                    lerp_duration = target->period_ms;
-                    lerp_duration_inv = (lerp_duration > 0) ? (1.0f / (float)lerp_duration) : 1.0f;
-                    if (breathing_forward) {
-                        lerp_color_initial = target->color_a;
-                        lerp_color_final = target->color_b;
-                    } else {
-                        lerp_color_initial = target->color_b;
-                        lerp_color_final = target->color_a;
-                    }
-                    hsv_simplify_pair(&lerp_color_initial, &lerp_color_final);
-                } else {
-                    current_step = RGB_INDICATOR_STEP_STATIC;
-                    hsv_set(lerp_color_final);
-                    return;
-                }
-                break;
-            }
-
-            case RGB_INDICATOR_STEP_BREATHING:
-                lerp_start_time = now;
-                {
-                    HSV tmp = lerp_color_initial;
-                    lerp_color_initial = lerp_color_final;
-                    lerp_color_final = tmp;
-                }
-                hsv_simplify_pair(&lerp_color_initial, &lerp_color_final);
-                break;
-
-            default:
-                return;
+    uint32_t elapsed = now - track_start_time;
+
+    // the minimum visible time only counts once the accent is actually showing, not while it is still fading in
+    if (track_kind == RGB_INDICATOR_TRACK_TRANSITION && !transition_visible && elapsed >= transition_accent_ms) {
+        transition_visible = true;
+        transition_visible_time = track_start_time + transition_accent_ms;
+    }
+
+    // a finished transition hands over to the target state, starting exactly where the transition ended
+    if (track_kind == RGB_INDICATOR_TRACK_TRANSITION && elapsed >= track_length) {
+        compile_state_track(track_start_time + track_length);
+        if (track_kind == RGB_INDICATOR_TRACK_STATIC) {
+            return;
         }
+        elapsed = now - track_start_time;
+    }
+
+    // breathing tracks loop forever
+    if (track_kind == RGB_INDICATOR_TRACK_BREATHING && elapsed >= track_length) {
+        elapsed %= track_length;
+        track_start_time = now - elapsed;
+        track_cursor = 0;
+    }
 
-        // Reset elapsed time after transitioning
-        elapsed = 0;
+    // advance the cursor to the segment that contains the current time
+    while (track_cursor < track_segment_count - 1 && elapsed >= track_segments[track_cursor].end_ms) {
+        track_cursor++;
     }
 
     // Interpolation step
-    float ratio = elapsed * lerp_duration_inv;
-    HSV current = hsv_lerp(lerp_color_initial, lerp_color_final, ratio);
-    hsv_set(current);
+    const rgb_indicator_segment_t *segment = &track_segments[track_cursor];
+    float ratio = (elapsed - segment->start_ms) * segment->duration_inv;
+    render_segment(segment, ratio);
+}
+
+#ifdef RGB_INDICATORS_RGB_MATRIX
+// the effect underneath has already turned every LED off, so only the lit ones are written
+bool rgb_matrix_indicators_rgb_indicators(void) {
+    for (uint16_t led = 0; led < RGB_MATRIX_LED_COUNT; led++) {
+        const RGB *color = &led_colors[led];
+        if (color->r != 0 || color->g != 0 || color->b != 0) {
+            rgb_matrix_set_color(led, color->r, color->g, color->b);
+        }
+    }
+    return true;
 }
+#endif
 
 // ============================================================================
 // USER API
 // ============================================================================
 
 void rgb_indicators_start_transition(uint8_t t_idx, uint8_t s_idx) {
-    transition_idx = t_idx;
-    state_idx = s_idx;
 
-    current_step = RGB_INDICATOR_STEP_FADE_IN;
-    lerp_start_time = timer_read32();
-    lerp_duration = rgb_indicator_transitions[transition_idx].fade_in_ms;
-    lerp_duration_inv = (lerp_duration > 0) ? (1.0f / (float)lerp_duration) : 1.0f;
-    lerp_color_initial = last_set_color;
-    lerp_color_final = rgb_indicator_transitions[transition_idx].accent_color;
-    hsv_simplify_pair(&lerp_color_initial, &lerp_color_final);
+    // collapse requests for the target that an unfinished transition is already heading to
+    // the pending slot has never been shown, so it is simply replaced below instead
+    if (!pending_request_queued && track_kind == RGB_INDICATOR_TRACK_TRANSITION && state_idx == s_idx) {
+        return;
+    }
+
+    // don't cut a visible transition short; wait for it in the pending slot instead
+    // if the active transition's accent hasn't become visible yet, it is replaced without anyone noticing
+    if (!transition_interruptible()) {
+        pending_request = (rgb_indicator_request_t){ .transition_idx = t_idx, .state_idx = s_idx };
+        pending_request_queued = true;
+        return;
+    }
+
+    pending_request_queued = false;
+    state_idx = s_idx;
+    compile_transition_track(t_idx, timer_read32());
 }
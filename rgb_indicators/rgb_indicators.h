@@ -19,18 +19,34 @@ typedef enum {
 } indicator_transition_t;
 */
 
+#ifdef RGB_INDICATORS_RGB_MATRIX
+// size of an led_mask array; bit (i % 8) of byte (i / 8) selects LED i
+#    define RGB_INDICATORS_LED_MASK_SIZE ((RGB_MATRIX_LED_COUNT + 7) / 8)
+#endif
+
 typedef struct rgb_indicator_state_t {
     bool breathing;           // If true, cycle between colors
     HSV color_a;              // For static, the single color; for breathing, endpoint A
     HSV color_b;              // For breathing, endpoint B
     uint16_t period_ms;       // Breathing period
+    const uint8_t *led_mask;  // rgb_matrix only; bitmask of LEDs that show this state (NULL for all)
 } rgb_indicator_state_t;
 
+typedef struct rgb_indicator_keyframe_t {
+    HSV color;                // Color to transition through
+    uint16_t fade_ms;         // Time to lerp from the previous keyframe
+    uint16_t hold_ms;         // Time to hold this keyframe
+} rgb_indicator_keyframe_t;
+
 typedef struct rgb_indicator_transition_t {
     HSV accent_color;         // Color to briefly transition through
     uint16_t fade_in_ms;      // Time to lerp to accent
     uint16_t hold_ms;         // Time to hold accent
     uint16_t fade_out_ms;     // Time to lerp to target
+    const rgb_indicator_keyframe_t *keyframes;  // Optional; replaces accent_color, fade_in_ms, and hold_ms
+    uint8_t keyframe_count;   // Number of entries in keyframes
+    uint16_t min_visible_ms;  // Optional; time this transition is shown before a newer one may interrupt it
+    const uint8_t *led_mask;  // rgb_matrix only; bitmask of LEDs that show the accent colors (NULL for all)
 } rgb_indicator_transition_t;
 
 extern const rgb_indicator_state_t rgb_indicator_states[];
@@ -1 +1,3 @@
-RGBLIGHT_ENABLE = yes
\ No newline at end of file
+ifneq ($(strip $(RGB_MATRIX_ENABLE)), yes)
+    RGBLIGHT_ENABLE = yes
+endif
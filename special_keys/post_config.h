@@ -0,0 +1,49 @@
+// Copyright 2026 Morgan Newell Sun
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+// taps that can be waiting to be sent, a macro that doesn't fit is dropped as a whole
+#ifndef SPECIAL_KEYS_MACRO_QUEUE_SIZE
+#    define SPECIAL_KEYS_MACRO_QUEUE_SIZE 16
+#endif
+
+// minimum time between the keyboard reports of a macro (ms), macOS misses keys that are tapped too quickly
+#ifndef SPECIAL_KEYS_MACRO_INTERVAL
+#    define SPECIAL_KEYS_MACRO_INTERVAL 1
+#endif
+
+#ifndef SPECIAL_KEYS_MACRO_INTERVAL_MACOS
+#    define SPECIAL_KEYS_MACRO_INTERVAL_MACOS 10
+#endif
+
+// with SPECIAL_KEYS_ARROW_REPEAT defined, held arrows start repeating after SPECIAL_KEYS_ARROW_REPEAT_DELAY ms (keep it below the host's
+// own repeat delay), every SPECIAL_KEYS_ARROW_REPEAT_INTERVAL ms at first, and the interval shrinks by SPECIAL_KEYS_ARROW_REPEAT_ACCELERATION
+// percent with every repeat down to SPECIAL_KEYS_ARROW_REPEAT_MIN_INTERVAL ms
+#ifndef SPECIAL_KEYS_ARROW_REPEAT_DELAY
+#    define SPECIAL_KEYS_ARROW_REPEAT_DELAY 250
+#endif
+
+#ifndef SPECIAL_KEYS_ARROW_REPEAT_INTERVAL
+#    define SPECIAL_KEYS_ARROW_REPEAT_INTERVAL 40
+#endif
+
+#ifndef SPECIAL_KEYS_ARROW_REPEAT_ACCELERATION
+#    define SPECIAL_KEYS_ARROW_REPEAT_ACCELERATION 5
+#endif
+
+#ifndef SPECIAL_KEYS_ARROW_REPEAT_MIN_INTERVAL
+#    define SPECIAL_KEYS_ARROW_REPEAT_MIN_INTERVAL 10
+#endif
+
+#if SPECIAL_KEYS_MACRO_QUEUE_SIZE < 1 || SPECIAL_KEYS_MACRO_QUEUE_SIZE > 255
+#    error "SPECIAL_KEYS_MACRO_QUEUE_SIZE must be between 1 and 255!"
+#endif
+
+#if SPECIAL_KEYS_ARROW_REPEAT_MIN_INTERVAL < 1 || SPECIAL_KEYS_ARROW_REPEAT_MIN_INTERVAL > SPECIAL_KEYS_ARROW_REPEAT_INTERVAL
+#    error "SPECIAL_KEYS_ARROW_REPEAT_MIN_INTERVAL must be between 1 and SPECIAL_KEYS_ARROW_REPEAT_INTERVAL!"
+#endif
+
+#if SPECIAL_KEYS_ARROW_REPEAT_ACCELERATION < 0 || SPECIAL_KEYS_ARROW_REPEAT_ACCELERATION > 99
+#    error "SPECIAL_KEYS_ARROW_REPEAT_ACCELERATION must be between 0 and 99!"
+#endif
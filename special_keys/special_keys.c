@@ -19,6 +19,142 @@ typedef enum special_keys_state_t {
 static special_keys_state_t state = SPECIAL_KEYS_STATE_NORMAL;
 uint16_t current_arrow_keycode = KC_NO;
 
+// macros are queued as taps and sent by the housekeeping task one keyboard report at a time, so they never hold up the scan
+static uint16_t macro_queue[SPECIAL_KEYS_MACRO_QUEUE_SIZE];
+static uint8_t macro_queue_head = 0;
+static uint8_t macro_queue_count = 0;
+static uint8_t macro_key = KC_NO;  // key the macro is holding down
+static uint8_t macro_mods = 0;     // weak modifiers the macro added, modifiers that were already held are left alone
+static uint16_t last_macro_report_time = 0;
+
+#ifdef SPECIAL_KEYS_ARROW_REPEAT
+// held arrows are repeated by the firmware as a release and a press, which keeps the host's own key repeat from kicking in
+static uint16_t repeat_keycode = KC_NO;  // arrow being repeated, KC_NO if none
+static bool repeat_released = false;     // the arrow is out of the report between the release and the press of a repeat
+static uint16_t repeat_interval;
+static uint16_t repeat_release_time;
+static uint16_t repeat_press_time;
+#endif
+
+// ============================================================================
+// INTERNAL FUNCTIONS
+// ============================================================================
+
+// keycodes are tapped like tap_code16 would, returns false if the whole macro doesn't fit in the queue
+static bool queue_macro(const uint16_t *keycodes, uint8_t count) {
+    if (count > SPECIAL_KEYS_MACRO_QUEUE_SIZE - macro_queue_count) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        macro_queue[(macro_queue_head + macro_queue_count) % SPECIAL_KEYS_MACRO_QUEUE_SIZE] = keycodes[i];
+        macro_queue_count++;
+    }
+    return true;
+}
+
+// the modifiers of a keycode like S(KC_HOME), as they appear in the keyboard report
+static uint8_t keycode_mods(uint16_t keycode) {
+    uint8_t mods = QK_MODS_GET_MODS(keycode);
+    return (mods & 0x10) ? (mods & 0x0F) << 4 : mods;
+}
+
+static uint8_t macro_interval(void) {
+    switch (detected_host_os()) {
+        case OS_MACOS:
+        case OS_IOS:
+            return SPECIAL_KEYS_MACRO_INTERVAL_MACOS;
+        default:
+            return SPECIAL_KEYS_MACRO_INTERVAL;
+    }
+}
+
+static void macro_task(void) {
+    if (macro_key == KC_NO && macro_mods == 0 && macro_queue_count == 0) {
+        return;
+    }
+    if (timer_elapsed(last_macro_report_time) < macro_interval()) {
+        return;
+    }
+    uint16_t next = (macro_queue_count > 0) ? macro_queue[macro_queue_head] : KC_NO;
+    uint8_t next_key = QK_MODS_GET_BASIC_KEYCODE(next);
+    uint8_t release_mods = macro_mods & ~keycode_mods(next);
+
+    // a key press shares its report with the modifiers it needs and with the release of the previous key, but not with the release
+    // of a modifier or of the same key, since the host can't tell the order of the changes within one report
+    bool press = macro_queue_count > 0 && release_mods == 0 && next_key != macro_key;
+    if (macro_key != KC_NO) {
+        del_key(macro_key);
+        macro_key = KC_NO;
+    }
+    del_weak_mods(release_mods);
+    macro_mods &= ~release_mods;
+    if (press) {
+        uint8_t missing_mods = keycode_mods(next) & ~(get_mods() | get_weak_mods());
+        add_weak_mods(missing_mods);
+        macro_mods |= missing_mods;
+        add_key(next_key);
+        macro_key = next_key;
+        macro_queue_head = (macro_queue_head + 1) % SPECIAL_KEYS_MACRO_QUEUE_SIZE;
+        macro_queue_count--;
+    }
+    send_keyboard_report();
+    last_macro_report_time = timer_read();
+}
+
+#ifdef SPECIAL_KEYS_ARROW_REPEAT
+// a is no earlier than b, with wraparound
+static bool time_reached(uint16_t a, uint16_t b) {
+    return (int16_t)(a - b) >= 0;
+}
+
+// the release of the next repeat goes out one report interval before its press
+static void schedule_arrow_repeat(uint16_t period) {
+    uint16_t gap = macro_interval();
+    repeat_press_time = timer_read() + ((period > 2 * gap) ? period : 2 * gap);
+    repeat_release_time = repeat_press_time - gap;
+}
+
+static void update_arrow_repeat(uint16_t keycode, bool pressed) {
+    if (pressed) {
+        if (repeat_keycode != KC_NO && repeat_released) {
+            // the arrow that was being repeated is still held, so put it back in the report
+            add_key(repeat_keycode);
+        }
+        repeat_keycode = keycode;
+        repeat_released = false;
+        repeat_interval = SPECIAL_KEYS_ARROW_REPEAT_INTERVAL;
+        schedule_arrow_repeat(SPECIAL_KEYS_ARROW_REPEAT_DELAY);
+    } else if (keycode == repeat_keycode) {
+        // QMK takes the arrow out of the report as usual
+        repeat_keycode = KC_NO;
+        repeat_released = false;
+    }
+}
+
+// only the arrow itself is released and pressed again, so modifiers that are held for it stay asserted for the whole burst
+static void arrow_repeat_task(void) {
+    if (repeat_keycode == KC_NO || macro_key != KC_NO || macro_queue_count > 0) {
+        return;
+    }
+    uint16_t now = timer_read();
+    if (!repeat_released && time_reached(now, repeat_release_time)) {
+        del_key(repeat_keycode);
+        send_keyboard_report();
+        repeat_released = true;
+    } else if (repeat_released && time_reached(now, repeat_press_time)) {
+        add_key(repeat_keycode);
+        send_keyboard_report();
+        repeat_released = false;
+        schedule_arrow_repeat(repeat_interval);
+        uint16_t step = (uint32_t)repeat_interval * SPECIAL_KEYS_ARROW_REPEAT_ACCELERATION / 100;
+        repeat_interval -= (step > 0) ? step : 1;
+        if (repeat_interval < SPECIAL_KEYS_ARROW_REPEAT_MIN_INTERVAL) {
+            repeat_interval = SPECIAL_KEYS_ARROW_REPEAT_MIN_INTERVAL;
+        }
+    }
+}
+#endif
+
 // ============================================================================
 // MODULE API
 // ============================================================================
@@ -40,6 +176,9 @@ bool process_record_special_keys(uint16_t keycode, keyrecord_t *record) {
                 current_arrow_keycode = KC_NO;
             }
         }
+#ifdef SPECIAL_KEYS_ARROW_REPEAT
+        update_arrow_repeat(keycode, record->event.pressed);
+#endif
     }
 
     // state machine
@@ -49,13 +188,16 @@ bool process_record_special_keys(uint16_t keycode, keyrecord_t *record) {
 
             if (keycode == KC_DELETE_LINE) {
                 if (record->event.pressed) {
-                    // tap_code(KC_MINUS);  // at one point I thought this was necessary - why?
-                    tap_code(KC_END);
-                    tap_code(KC_END);
-                    tap_code16(S(KC_HOME));
-                    tap_code16(S(KC_HOME));
-                    tap_code16(S(KC_LEFT));
-                    tap_code(KC_BSPC);
+                    static const uint16_t delete_line[] = {
+                        // KC_MINUS,  // at one point I thought this was necessary - why?
+                        KC_END,
+                        KC_END,
+                        S(KC_HOME),
+                        S(KC_HOME),
+                        S(KC_LEFT),
+                        KC_BSPC,
+                    };
+                    queue_macro(delete_line, ARRAY_SIZE(delete_line));
                 }
                 return false;
             } else if (keycode == KC_VSCODE_ADD_CURSOR) {
@@ -174,3 +316,10 @@ bool process_record_special_keys(uint16_t keycode, keyrecord_t *record) {
             return false;
     }
 }
+
+void housekeeping_task_special_keys(void) {
+    macro_task();
+#ifdef SPECIAL_KEYS_ARROW_REPEAT
+    arrow_repeat_task();
+#endif
+}